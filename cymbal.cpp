@@ -18,37 +18,58 @@
 * prepared by: Nick Beato
 * 4/12/03
 * revised for the new problem spec: 4/21/03
+*
+* compile with: g++ -O2 -pthread cymbal.cpp
+* (it needs a POSIX system, for read() and friends)
+*
+* To use the solver from another program instead, see cymbal.h.
 ******************************************************************************/
 
 /******************************************************************************
 * includes
 ******************************************************************************/
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cctype>
+#include <cerrno>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
 #include <fstream>
+#include <iomanip>
 #include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "cymbal.h"
 
 using namespace std;
 
 /******************************************************************************
 * constants
 *
-* MAX_CASE: This is the maximum number of switches possible in the spec + 1
+* EDGE_SHIFT, EDGE_DEFAULT: A track is stored as one int. The switch it goes
+*				to is shifted up by EDGE_SHIFT and the bottom bit (EDGE_DEFAULT)
+*				is set if the track is the switch's default setting.
 *
-* NOT_CONNECTED: This is the value indicating that a switch does not directly
-*				connect switch A to B.
-*
-* DEFAULT_CONNECTED: This indicates that two switches are connected by a track
-*               by default. ie, you don't have to flip the switch and it is
-*				"free" to go from switch A to switch B (or come from A to B).
-*
-* SWITCH_CONNECTED: This indicates that two switches can be connected directly
-*				by a track.  However, switch A must be chanegd before we can
-*				go onto the track leading from A to B.
-*
-* FORWARD_DEFAULT: A track connects the two switches AND	it is the default 
-*				connection to get from A to B. This is the sum of 
-*				DEFAULT_CONNECTED and SWITCH_CONNECTED to add both values to 
-*				0. If it is both, then we will get this value.
+* EDGE_FORWARD_FLIP, EDGE_BACKWARD_FLIP: The next two bits of a track say
+*				what rolling down it costs: the switch it leaves has to be
+*				thrown to it, and the switch it goes to has to be thrown
+*				back to it. See mark_track_costs.
 *
 * LARGE_NUMBER: This is just some arbitrary, but large, number. 
 *               We will never have to flip more switches than this so it's the
@@ -56,638 +77,7421 @@ using namespace std;
 *				We could also use a bool to store whether or not we have found
 *				an answer, but this is easier to do (and could possibly lead
 *				to a bug if LARGE_NUMBER is smaller than the answer).
+*				Every track costs at most 2 flips, so this covers routes
+*				through hundreds of millions of switches.
 *
 * NOTHING_DONE: This indicates that we haven't done anything yet and primarily
 *				initializes values to zero.
+*
+* SCALE_SMALLEST, SCALE_LARGEST: The smallest and largest yards the -scale
+*				benchmark builds. It goes up by a factor of 10 each time.
+*
+* SCALE_BRANCHES: The most tracks a switch has in the -scale yards.
+*
+* TASKS_PER_THREAD: When one search is split between threads, try to cut it
+*				into at least this many pieces per thread, so a thread that
+*				finishes early has something left to pick up.
+*
+* SPLIT_DEPTH:	...but don't go more than this many switches deep looking for
+*				places to cut it.
+*
+* TASK_BITS:	An incumbent shared between threads is stored as
+*				(flips << TASK_BITS) + task, so comparing two of them
+*				compares flips first and which task found it second.
+*
+* READ_BLOCK:	How many bytes track_reader reads from the file at a time.
+*
+* WRITE_BLOCK:	track_writer saves up about this many bytes of output before
+*				writing them out.
+*
+* LARGEST_INPUT: No number in the input can be bigger than this. It keeps a
+*				switch number shifted up by EDGE_SHIFT inside an int.
+*
+* PARSE_BENCH_BYTES: -parse-bench reads the input over and over until it has
+*				gone through about this many bytes with each reader.
+*
+* BATCH_PER_THREAD: With -threads, read and solve this many systems per
+*				thread at a time, so a file with any number of systems only
+*				needs memory for one batch of them.
+*
+* BENCH_SMALLEST, BENCH_LARGEST: The smallest and biggest yards -bench
+*				makes. Like -scale, it goes up by a factor of 10 each time.
+*
+* BENCH_SWITCHES: How many switches -bench puts in each file it times, all
+*				together. Small yards get lots of systems, big ones get few.
+*
+* BENCH_DFS_LARGEST: -bench only times solve_for_one_switch on yards up to
+*				this size. A 100 switch yard already takes it tens of
+*				milliseconds, and -bench makes thousands of them.
+*
+* CHECK_DFS_LARGEST: -check only runs solve_for_one_switch on systems up to
+*				this size, for the same reason.
+*
+* NO_THROW:		What check_route uses to say a switch on a route isn't
+*				thrown.
+*
+* EDIT_BENCH_SMALLEST: The smallest yard -edit-bench changes. It goes up by
+*				a factor of 10 each time, up to BENCH_LARGEST.
+*
+* EDIT_BENCH_EDITS: How many changes -edit-bench makes to each yard.
+*
+* NO_SIDETRACK: What find_best_routes uses for a heap with nothing in it,
+*				or a switch with no track to take.
+*
+* ROUTE_BENCH_MOST: The most routes -route-bench asks for. It starts at 1
+*				and goes up by a factor of 10 each time.
+*
+* CHECK_ROUTES: How many routes -check asks find_best_routes for.
+*
+* NOT_REMEMBERED: What solve_for_one_switch_memo keeps for a switch it
+*				hasn't been to yet.
+*
+* COMPILED_MAGIC, COMPILED_VERSION: The first 8 bytes of a compiled yard
+*				file (see -compile), and which version of its layout it
+*				has. A file with another version has to be compiled again.
+*
+* COMPILED_BYTE_ORDER: A compiled file keeps its numbers the way this
+*				machine keeps them in memory. This one goes in the header, so
+*				a machine that keeps them the other way around reads it back
+*				wrong and knows not to trust the rest.
+*
+* SEARCH_BUDGET: How many switches the depth first search can arrive at
+*				on one system before it gives up and lets
+*				solve_for_one_switch_memo finish it (see -budget). That's
+*				a second or so of searching.
+*
+* SMALL_YARD_LARGEST: Yards with up to this many switches are solved by
+*				solve_small_yard (see -no-small), which keeps everything
+*				it works out in arrays this big on the stack.
+*
+* NOT_A_ROUTE:	What score_paths says a route flips if it isn't a way out
+*				of the yard.
+*
+* SCORE_BENCH_ROUTES, SCORE_BENCH_STEPS: -score-bench scores this many
+*				routes in each yard, or fewer if they'd go over this many
+*				switches all together (in a big yard, routes get long).
+*
+* SERVE_BACKLOG: -serve stops reading a client's questions once it has
+*				this many bytes of answers the client hasn't read yet, so a
+*				client that never reads can't make it use up all its memory.
+*
+* SERVE_LONGEST_QUERY: A question to -serve longer than this (without a
+*				newline) can't be a real one, so it gets an error and is
+*				thrown out.
+*
+* LOAD_TEST_QUERIES, LOAD_TEST_PIPELINE: How many questions -load-test
+*				asks, and how many it keeps waiting at once, unless we say
+*				(see -queries and -pipeline).
 ******************************************************************************/
 
-const int MAX_CASE				= 101;
-const int NOT_CONNECTED			= 0;
-const int DEFAULT_CONNECTED		= 2;
-const int SWITCH_CONNECTED		= 1;
-const int FORWARD_DEFAULT		= 3;
-const int LARGE_NUMBER			= 1000000;
+const int EDGE_SHIFT			= 3;
+const int EDGE_DEFAULT			= 1;
+const int EDGE_FORWARD_FLIP		= 2;
+const int EDGE_BACKWARD_FLIP	= 4;
+const int LARGE_NUMBER			= 1000000000;
 const int NOTHING_DONE			= 0;
+const int SCALE_SMALLEST		= 100;
+const int SCALE_LARGEST			= 10000000;
+const int SCALE_BRANCHES		= 3;
+const int TASKS_PER_THREAD		= 8;
+const int SPLIT_DEPTH			= 64;
+const int TASK_BITS				= 32;
+const int READ_BLOCK			= 1 << 16;
+const int WRITE_BLOCK			= 1 << 16;
+const int LARGEST_INPUT			= 999999999 >> EDGE_SHIFT;
+const long long PARSE_BENCH_BYTES	= 64 << 20;
+const int BATCH_PER_THREAD		= 64;
+const int BENCH_SMALLEST		= 10;
+const int BENCH_LARGEST			= 1000000;
+const int BENCH_SWITCHES		= 1000000;
+const int BENCH_DFS_LARGEST		= 10;
+const int CHECK_DFS_LARGEST		= 100;
+const int NO_THROW				= -1;
+const int EDIT_BENCH_SMALLEST	= 1000;
+const int EDIT_BENCH_EDITS		= 100;
+const int NO_SIDETRACK			= -1;
+const int ROUTE_BENCH_MOST		= 1000;
+const int CHECK_ROUTES			= 100;
+const int NOT_REMEMBERED		= -1;
+const char COMPILED_MAGIC[]		= "CYMBALYD";
+const int COMPILED_VERSION		= 1;
+const int COMPILED_BYTE_ORDER	= 0x01020304;
+const long long SEARCH_BUDGET	= 100000000;
+const int SMALL_YARD_LARGEST	= 256;
+const int NOT_A_ROUTE			= -1;
+const int SCORE_BENCH_ROUTES	= 100000;
+const int SCORE_BENCH_STEPS		= 10000000;
+const int SERVE_BACKLOG			= 1 << 20;
+const int SERVE_LONGEST_QUERY	= 256;
+const int LOAD_TEST_QUERIES		= 100000;
+const int LOAD_TEST_PIPELINE	= 32;
 
 /******************************************************************************
-* function prototypes (detailed information can be found in the instantiation)
+* allocations
+* How many times anything has asked for memory, for -bench. Only cymbal
+* itself counts them (see operator new, above main). A program using
+* cymbal.h keeps its own operator new, so for it this just stays 0.
 ******************************************************************************/
 
-int get_starting(int connectivity[MAX_CASE][MAX_CASE], int num_switches);
+atomic<long long> allocations(0);
 
-void solve_for_one_switch(const int connectivity[MAX_CASE][MAX_CASE],
-						  const int &switches_used,
-						  int current_val,
-						  int current_switch,
-						  int last_switch,
-						  int &best_so_far,
-						  int answer[MAX_CASE],
-						  int answer_index,
-						  int best_answer[MAX_CASE]);
+/******************************************************************************
+* serving
+* -serve keeps answering until this goes false, which stop_serving does
+* when it's told to stop (Ctrl-C, or kill).
+******************************************************************************/
 
-int connects_to_x(const int connectivity[MAX_CASE][MAX_CASE],
-				  const int &switches_used,
-				  const int &switch_num);
+volatile sig_atomic_t serving = 1;
 
+/******************************************************************************
+* search_stats
+* What a solver did while it solved one system, for -profile. Counting is
+* just adding one to a number the solver is already looking at, so it's
+* always on.
+*
+* arrivals:     How many times a switch was looked at. For the depth first
+*				search, that's every arrive_at_switch (every call of
+*				solve_for_one_switch, back when it called itself). For
+*				solve_by_dp, every switch in its order.
+*
+* prunes:       How many times the search gave up on a path because it had
+*				thrown as many switches as the best answer already did (or,
+*				for solve_for_one_switch_memo, because it already knew the
+*				way out from where the path went).
+*
+* improvements: How many times the search found a better answer than the
+*				one it had.
+*
+* max_depth:    The most switches on any path the search got to, counting
+*				the one it just got to (for solve_by_dp, the route it
+*				found).
+******************************************************************************/
 
-void array_copy(int to[MAX_CASE], const int from[MAX_CASE], int up_to_n);
+struct search_stats
+{
+  long long arrivals;
+  long long prunes;
+  long long improvements;
+  int max_depth;
+};
 
 /******************************************************************************
-* main entry point
+* track_graph
+* This is how the switches connect to each other for one track system.
+*
+* Every switch only has a handful of tracks leaving it, so instead of a
+* switches by switches table we keep one long list of tracks, grouped by the
+* switch they leave from (this is called "compressed sparse row" if you want
+* to look it up). The tracks leaving switch A are
+*
+*		out_track[out_start[A]] ... out_track[out_start[A + 1] - 1]
+*
+* sorted by the switch they go to. The same is done for the tracks coming
+* into each switch with in_start and in_track, which just hold the switch the
+* track comes from.
+*
+* Everything is sized to the system that was read in, so a yard takes memory
+* for its switches and tracks and nothing else. Switch 0 is never used.
+*
+* switches_used:   How many switches exist in this system.
+*
+* default_setting: Which switch each switch is set to. It can be looking
+*				   "forward" (down one of its out tracks) or "backward" (up
+*				   one of the tracks coming into it).
+*
+* The degree index is filled in once by build_degree_index after reading:
+*
+* out_degree:      How many tracks leave each switch (connects_to_x).
+*
+* in_degree:       How many tracks come into each switch.
+*
+* sources:         Every switch with nothing coming into it, in order. The
+*				   first one is where Skippy starts.
+*
+* order:           The switches in topological order (see solve_by_dp),
+*				   once check_yard has worked it out (or the yard was
+*				   loaded from a compiled file). Until then it's empty.
+*
+* degree_lookups:  How many times connects_to_x was asked about this system.
+*				   Before the index, every one of these was a scan of a whole
+*				   row of the table. Only used for -stats.
+*
+* stats:           What the last solve of this system did. Only used for
+*				   -profile.
 ******************************************************************************/
 
-int main()
+struct track_graph
 {
-  /**************************************************************************
-   * Declare the file stream and open the file
-   **************************************************************************/
+  int switches_used;
+  vector<int> default_setting;
 
-  ifstream infile;
-  infile.open("cymbal.in");
+  vector<int> out_start;
+  vector<int> out_track;
 
-  /**************************************************************************
-   * This is probably one of the harder problems to solve. So, I'm going to
-   * explain the purpose of every single variable here (or try to...)
-   **************************************************************************/
+  vector<int> in_start;
+  vector<int> in_track;
 
-  /**************************************************************************
-   * connectivity
-   * This is an adjacency matrix.
-   * It simply represents how two switches connect to each other. For the
-   * purposes of this problem, it indicates how the tracks link switches.
-   * (more can be found by researching "graph theory")
-   * 
-   * for example:
-   * connectivity[2][3] will "know" how switch 2 can connect to switch 3
-   *
-   * connectivity[from][to] has 4 possible values: These are the global 
-   * constants that I used at the beginning of this file. I'll say it
-   * again to try to make my point clear.
-   *
-   * If connectivity[A][B] (A and B are ints) equals:
-   *
-   *  NOT_CONNECTED: We cannot go directly from A to B.
-   *
-   *  DEFAULT_CONNECTED: Switch A has a track leading to B and is ready to
-   *			connect A to B without touching the switch.
-   *			Note: this means it is looking "forward" or "backward"
-   *
-   *  SWITCH_CONNECTED: Switch A branches "forward" to B (the inverse is
-   *			implied, but we don't need to store this, as we cannot go
-   *			backwards on the track due to gravity.
-   *
-   *  FORWARD_DEFAULT: Switch A has a track leading to B and it does not
-   *			need to be switched to travel to B. This is simply the sum
-   *			of both other connections this represents.
-   *
-   * Note that the problem is acyclic, meaning you cannot return to a switch
-   * that you've already visited. This is possible because the minecars are
-   * moving due to gravity and we cannot move back up the track.
-   * This means that we don't have to remember where we have been! yey!!
-   *
-   * Also note that the input specification is 1 based, not 0 based like
-   * arrays are in c++/java. Instead of converting back and forth, I'm going
-   * to use 1-based indexing.  So anything in row 0 or column 0 doesn't have
-   * relevance to our problem! This should prevent some indexing bugs.
-   **************************************************************************/
+  vector<int> out_degree;
+  vector<int> in_degree;
+  vector<int> sources;
 
-  int connectivity[MAX_CASE][MAX_CASE];
+  vector<int> order;
 
-  /**************************************************************************
-   * total_systems: How many systems to solve in this particular file.
-   *
-   * total_switches: How many switches are in the current system.
-   *
-   * lowest_switches: The lowest number of switches used to get to the answer
-   *		so far (this could change every time or be found right away).
-   *
-   * cur_answer: The order that the current answer is using. We don't need to
-   *		worry about a longer path because we definately should not
-   *		visit any switch more than once.
-   *
-   * best_answer: The path of the best answer that we want to print out.
-   *
-   * starting_switch: This is where Skippy is!
-   **************************************************************************/
+  mutable long long degree_lookups;
+  mutable search_stats stats;
+};
+
+/******************************************************************************
+* search_frame
+* One switch on the path solve_for_one_switch is currently trying.
+*
+* current_switch: Which switch this is.
+*
+* current_val:    The number of switches we've thrown to get here.
+*
+* next_track:     The next of its tracks to try.
+******************************************************************************/
+
+struct search_frame
+{
+  int current_switch;
+  int current_val;
+  int next_track;
+};
+
+/******************************************************************************
+* search_state
+* Everything one depth first search keeps track of as it goes.
+*
+* answer:      The current path we are taking, as a stack of search_frames.
+*
+* best_so_far: Lowest number of switches thrown in all previous solutions.
+*
+* best_answer: The path of the best answer we've found so far.
+*
+* best_shared: How many switches at the start of answer are known to be the
+*			   same as the start of best_answer. See update_best_answer.
+*
+* incumbent:   When the search is split between threads, the best
+*			   (flips << TASK_BITS) + task found by any of them. NULL when
+*			   the search is running by itself.
+*
+* task:        Which piece of a split search this is.
+*
+* stats:       What this search has done so far.
+*
+* budget:      How many arrivals (in stats) the search gets before it gives
+*			   up, or 0 for as many as it takes.
+*
+* gave_up:     Whether it did. Its best answer is then just the best one it
+*			   had time to find.
+*
+* degree_lookups: How many times connects_to_x was asked. It's counted here,
+*			   not in the graph, since the threads of a split search all
+*			   share one graph. Whoever started the search adds it on
+*			   when it's done.
+******************************************************************************/
+
+struct search_state
+{
+  vector<search_frame> answer;
+  int best_so_far;
+  vector<int> best_answer;
+  int best_shared;
+
+  atomic<long long> *incumbent;
+  int task;
+
+  search_stats stats;
+  long long budget;
+  bool gave_up;
+  long long degree_lookups;
+};
+
+/******************************************************************************
+* memo_frame, memo_state
+* What solve_for_one_switch_memo keeps track of.
+*
+* answer:      The path it's on right now, one memo_frame (a switch, and the
+*			   next of its tracks to try) for each switch.
+*
+* below:       For every switch, the fewest flips from there to the exit, not
+*			   counting the switch itself being thrown backward (that
+*			   depends on the track the cart came in on, and is already in
+*			   that track's step_cost). NOT_REMEMBERED until the search has
+*			   been there.
+*
+* best_track:  The track that gets that many, for every switch it knows
+*			   below for (NO_SIDETRACK for an exit).
+******************************************************************************/
+
+struct memo_frame
+{
+  int current_switch;
+  int next_track;
+};
+
+struct memo_state
+{
+  vector<memo_frame> answer;
+  vector<int> below;
+  vector<int> best_track;
+};
+
+/******************************************************************************
+* search_task
+* One piece of a search split between threads: the part of the yard below
+* current_switch, reached by rolling down the switches in prefix and then
+* from last_switch with current_val switches thrown so far (not counting
+* current_switch itself).
+******************************************************************************/
+
+struct search_task
+{
+  vector<int> prefix;
+  int current_switch;
+  int last_switch;
+  int current_val;
+};
+
+/******************************************************************************
+* solve_options
+* How main was asked to solve the track systems.
+*
+* use_dfs:        Use solve_for_one_switch instead of solve_by_dp.
+*
+* search_threads: With use_dfs, how many threads search each system.
+*
+* all_starts:     Work out how many flips it takes to get out from every
+*				  switch, not just Skippy's, and print that instead of the
+*				  route (see print_start_costs).
+*
+* every_switch:   With all_starts, print every switch, not just the ones
+*				  nothing comes into.
+*
+* routes:         Print this many routes, best first, instead of just the
+*				  one (see find_best_routes). 0 means just the one.
+*
+* ties:           Print every route that throws as few switches as the best
+*				  one does (but no more than routes of them, if it isn't 0).
+*
+* memo:           With use_dfs, use solve_for_one_switch_memo, which only
+*				  goes below each switch once.
+*
+* budget:         With use_dfs, how many switches the search can arrive at
+*				  before it gives up and solve_for_one_switch_memo finishes
+*				  instead. 0 means it never gives up.
+*
+* small_yards:    Without use_dfs, solve yards of up to SMALL_YARD_LARGEST
+*				  switches with solve_small_yard.
+******************************************************************************/
+
+struct solve_options
+{
+  bool use_dfs;
+  bool memo;
+  int search_threads;
+  bool all_starts;
+  bool every_switch;
+  int routes;
+  bool ties;
+  long long budget;
+  bool small_yards;
+};
+
+/******************************************************************************
+* track_reader
+* Reads the input file a big block at a time and picks the numbers straight
+* out of the block, instead of going through ifstream >> for every number.
+* It also keeps track of which line it is on, so it can say where the input
+* is wrong instead of quietly reading garbage.
+*
+* file:   The file we are reading (a file descriptor, so reading stdin from
+*		  a pipe gives us whatever has arrived instead of waiting for a
+*		  whole block).
+*
+* name:   Its name, for error messages.
+*
+* buffer: The block of the file we are working on, buffer[pos] up to
+*		  buffer[end] haven't been looked at yet.
+*
+* line:   Which line of the file buffer[pos] is on.
+*
+* bytes:  How many bytes have been read from the file so far.
+*
+* mapped: If the file is a compiled yard file, all of it, mapped into
+*		  memory by open_reader. NULL if it's text.
+*
+* mapped_size, mapped_pos: How big the compiled file is, and how far into
+*		  it we've loaded.
+*
+* spot:   Working space for check_compiled_system, kept here so loading
+*		  system after system doesn't keep asking for memory.
+******************************************************************************/
+
+struct track_reader
+{
+  int file;
+  const char *name;
+
+  vector<char> buffer;
+  int pos;
+  int end;
+
+  int line;
+  long long bytes;
+
+  const char *mapped;
+  size_t mapped_size;
+  size_t mapped_pos;
+
+  vector<int> spot;
+};
+
+/******************************************************************************
+* compiled_header, compiled_system
+* The layout of a compiled yard file, the kind -compile writes. It's the
+* track_graphs pretty much the way they sit in memory, so loading one is a
+* handful of copies instead of reading every number as text:
+*
+*		a compiled_header, then for every track system, a compiled_system
+*		followed by its default_setting, out_start, out_track, in_start,
+*		in_track, out_degree, in_degree, sources and order,
+*
+* all of them ints, sized like track_graph says. out_track keeps its EDGE_
+* bits, so edge_shift has to be the same EDGE_SHIFT we were built with.
+*
+* total_systems: How many track systems follow.
+*
+* tracks, sources, order: How long out_track (and in_track), sources and
+*				 order are for this system.
+******************************************************************************/
+
+struct compiled_header
+{
+  char magic[8];
+  int version;
+  int byte_order;
+  int edge_shift;
+  int total_systems;
+};
+
+struct compiled_system
+{
+  int switches_used;
+  int tracks;
+  int sources;
+  int order;
+};
+
+/******************************************************************************
+* serve_client
+* One program connected to -serve.
+*
+* socket:   Its end of the connection (never blocks).
+*
+* in:       What it has sent that isn't a whole line yet.
+*
+* out:      Answers it hasn't read yet, starting at out_done.
+*
+* finished: It hung up (or something went wrong), so once out is sent,
+*			it's closed.
+******************************************************************************/
+
+struct serve_client
+{
+  int socket;
+
+  string in;
+  string out;
+  size_t out_done;
+
+  bool finished;
+};
+
+/******************************************************************************
+* track_writer
+* Where the answers go. Printing a route is a lot of little numbers and
+* spaces, so instead of handing every one of them to cout (and flushing
+* with endl), print_track_system adds them to buffer, and write_output only
+* sends buffer to the file once it gets to WRITE_BLOCK bytes. The buffer
+* keeps its memory, so after the first few systems it's just reused.
+*
+* file:   Where the output goes.
+*
+* buffer: Output that hasn't been written yet.
+******************************************************************************/
+
+struct track_writer
+{
+  FILE *file;
+  string buffer;
+};
+
+/******************************************************************************
+* track_profile
+* Where -profile writes one line for every track system.
+*
+* file:  Where the lines go.
+*
+* json:  Write a JSON array of objects instead of CSV.
+*
+* first: Nothing has been written after the header yet.
+******************************************************************************/
+
+struct track_profile
+{
+  FILE *file;
+  bool json;
+  bool first;
+};
+
+/******************************************************************************
+* route_list
+* The best few routes out of a yard, best first, for -routes and -ties.
+* They're kept like the tracks in track_graph, one after another in one
+* long list:
+*
+*		route R is switches[start[R]] ... switches[start[R + 1] - 1]
+*
+* flips: How many switches route R throws.
+******************************************************************************/
+
+struct route_list
+{
+  vector<int> flips;
+  vector<int> start;
+  vector<int> switches;
+};
+
+/******************************************************************************
+* track_system
+* Everything about one "Track System N:" in the input, from reading it to
+* printing it. main only needs one of these at a time, but -threads reads
+* them all in first so they can be solved at the same time.
+*
+* t_count:         Which track system this is (N).
+*
+* graph:           How its tracks link its switches together.
+*
+* starting_switch: This is where Skippy is!
+*
+* lowest_switches: The lowest number of switches used to get to the answer.
+*
+* best_answer:     The path of the best answer that we want to print out.
+*
+* output:          With -threads, the printed answer waiting its turn.
+*				   (Without -threads, it goes straight to the writer.)
+*
+* parse_ms, solve_ms, print_ms: How long reading, solving and printing it
+*				   took, for -profile.
+*
+* exit_cost:       The fewest flips from every switch to the exit (unless
+*				   it was solved with -dfs).
+*
+* routes:          With -routes or -ties, the best routes out.
+*
+* order, in_degree: Working space for solve_all_starts.
+*
+* problem:         What's wrong with the yard, if check_yard found
+*				   something. A system with a problem isn't solved or
+*				   printed. Empty if it's fine.
+*
+* gave_up:         Whether the depth first search ran out of budget, so
+*				   solve_for_one_switch_memo had to finish it.
+*
+* The vectors all keep their memory from one system to the next, so main
+* (which reuses one track_system, or with -threads one batch of them) stops
+* asking for memory once it has seen its biggest system. Clearing one out is
+* just setting its size back to 0.
+******************************************************************************/
+
+struct track_system
+{
+  int t_count;
+  track_graph graph;
+
+  int starting_switch;
+  int lowest_switches;
+  vector<int> best_answer;
+
+  string output;
+
+  double parse_ms;
+  double solve_ms;
+  double print_ms;
+
+  vector<int> exit_cost;
+  route_list routes;
+
+  vector<int> order;
+  vector<int> in_degree;
+
+  string problem;
+  bool gave_up;
+};
+
+/******************************************************************************
+* yard_shape
+* What kind of made up yard make_random_yard builds, for -generate and
+* -bench.
+*
+* switches_used:   How many switches. The last one is the only exit.
+*
+* branches:        The most tracks that can leave one switch.
+*
+* merge_percent:   How often (out of 100) a track runs into a switch that
+*				   another track already runs into (a trailing-point merge),
+*				   instead of into a switch nothing has reached yet.
+*
+* forward_percent: How often (out of 100) a switch with more than one track
+*				   leaving it is set forward down one of them, instead of
+*				   backward up a track coming into it.
+*
+* seed:            Where the random numbers start. The same shape and seed
+*				   always make the same yard.
+******************************************************************************/
+
+struct yard_shape
+{
+  int switches_used;
+  int branches;
+  int merge_percent;
+  int forward_percent;
+  unsigned int seed;
+};
+
+/******************************************************************************
+* solved_yard
+* A track system that stays in memory after it's solved, so it can be
+* changed a little (set_default, close_track) and brought up to date with
+* resolve_yard, instead of being read and solved all over again.
+*
+* system:    The system, with the answer to how it is right now.
+*
+* order:     Its switches in topological order (see solve_by_dp).
+*
+* position:  Where each switch is in order.
+*
+* exit_cost: The fewest flips from each switch to the exit.
+*
+* dirty:     The positions of the switches resolve_yard has to work out
+*			 again. It's a heap, so the one furthest down the hill comes
+*			 out first.
+*
+* queued:    Whether each switch is in dirty already.
+*
+* in_degree: Where topological_order counts. It's kept so solving the yard
+*			 again doesn't have to ask for new memory.
+******************************************************************************/
+
+struct solved_yard
+{
+  track_system system;
+
+  vector<int> order;
+  vector<int> position;
+  vector<int> exit_cost;
+  vector<int> in_degree;
+
+  priority_queue<int> dirty;
+  vector<bool> queued;
+};
+
+/******************************************************************************
+* track_solver
+* What cymbal.h hands out: one solved_yard, plus how far along building it
+* we are.
+*
+* switches_added: How many switches add_switch has added so far.
+*
+* solved:         Whether the yard has been solved since start_yard, so
+*				  solve_route only has to bring it up to date.
+******************************************************************************/
+
+struct track_solver
+{
+  solved_yard yard;
+
+  int switches_added;
+  bool solved;
+};
+
+/******************************************************************************
+* sidetrack
+* A track off of the best route from the switch it leaves (the track
+* walk_best_path would take). Taking it costs delta more flips than
+* staying on the best route would:
+*
+*		step_cost(track) + exit_cost[where it goes] - exit_cost[from]
+*
+* They're kept in leftist heaps, smallest delta on top. A heap is never
+* changed once it's built (merging copies the nodes it would change), so
+* the heap for one switch can be shared by every switch above it. See
+* sidetrack_heap.
+*
+* track:       The track, as a spot in out_track.
+*
+* from:        The switch it leaves.
+*
+* left, right: The heaps under this one, or NO_SIDETRACK.
+*
+* rank:        How many nodes it is down the right side to the bottom.
+******************************************************************************/
+
+struct sidetrack
+{
+  int delta;
+  int track;
+  int from;
+  int left;
+  int right;
+  int rank;
+};
+
+/******************************************************************************
+* route_taken, route_candidate
+* Every route find_best_routes finds is one it already found, with one more
+* sidetrack taken. A route_taken is that sidetrack (from and track) and the
+* route_taken of the route before it (before, NO_SIDETRACK for the best
+* route), so following before back lists every sidetrack a route takes.
+*
+* A route_candidate is a route that hasn't come out yet: the sidetrack heap
+* node to take after the route_taken before.
+******************************************************************************/
+
+struct route_taken
+{
+  int from;
+  int track;
+  int before;
+};
+
+struct route_candidate
+{
+  int node;
+  int before;
+};
+
+/******************************************************************************
+* route_search
+* Everything find_best_routes keeps track of.
+*
+* sidetracks: Every heap node, for every switch's heap.
+*
+* heap:       For each switch, the heap of every sidetrack off of the best
+*			  route from there to the exit, or NO_SIDETRACK if there are
+*			  none.
+*
+* built:      Whether each switch's heap has been worked out. Only the ones
+*			  some route goes through ever are.
+*
+* best_track: The track walk_best_path takes out of each switch, or
+*			  NO_SIDETRACK for an exit.
+*
+* taken, candidates: See route_taken.
+*
+* waiting:    The candidates, as (flips << TASK_BITS) + candidate, so the
+*			  one with the fewest flips comes out first, and ties come out
+*			  in the order they went in.
+*
+* chain, path_taken: Working space for sidetrack_heap and add_found_route.
+******************************************************************************/
+
+struct route_search
+{
+  vector<sidetrack> sidetracks;
+  vector<int> heap;
+  vector<bool> built;
+  vector<int> best_track;
+
+  vector<route_taken> taken;
+  vector<route_candidate> candidates;
+  priority_queue<long long, vector<long long>, greater<long long> > waiting;
+
+  vector<int> chain;
+  vector<int> path_taken;
+};
+
+/******************************************************************************
+* function prototypes (detailed information can be found in the instantiation)
+******************************************************************************/
+
+void finish_switch(track_graph &graph, int switch_num);
+
+void build_in_tracks(track_graph &graph);
+
+void build_degree_index(track_graph &graph);
+
+void mark_track_costs(track_graph &graph, int switch_num);
+
+int track_cost_bits(const track_graph &graph, int from_switch, int track);
+
+int get_starting(const track_graph &graph);
+
+bool solve_for_one_switch(const track_graph &graph,
+						  int starting_switch,
+						  int &best_so_far,
+						  vector<int> &best_answer,
+						  long long budget);
+
+void continue_search(const track_graph &graph, search_state &state);
+
+bool arrive_at_switch(const track_graph &graph,
+					  search_state &state,
+					  int current_val,
+					  int current_switch,
+					  int last_switch);
+
+int backward_cost(const track_graph &graph,
+				  int current_switch,
+				  int last_switch,
+				  long long &lookups);
+
+bool solve_for_one_switch_threaded(const track_graph &graph,
+								   int starting_switch,
+								   int &best_so_far,
+								   vector<int> &best_answer,
+								   int threads,
+								   long long budget);
+
+void solve_for_one_switch_memo(const track_graph &graph,
+							   int starting_switch,
+							   int &best_so_far,
+							   vector<int> &best_answer);
+
+void finish_memo_switch(const track_graph &graph, memo_state &state,
+						int current_switch);
+
+void split_search(const track_graph &graph,
+				  int starting_switch,
+				  vector<search_task> &tasks,
+				  int wanted);
+
+void run_search_task(const track_graph &graph,
+					 const search_task &task,
+					 search_state &state);
+
+int connects_to_x(const track_graph &graph, const int &switch_num,
+				  long long &lookups);
+
+void solve_by_dp(const track_graph &graph,
+				 int starting_switch,
+				 int &best_so_far,
+				 vector<int> &best_answer);
+
+void topological_order(const track_graph &graph, vector<int> &order,
+					   vector<int> &in_degree);
+
+bool check_yard(track_graph &graph, vector<int> &in_degree, string &problem);
+
+int find_loop(const track_graph &graph, vector<int> &in_degree);
+
+bool has_neighbor(const track_graph &graph, int switch_num, int neighbor);
+
+void solve_all_starts(const track_graph &graph,
+					  vector<int> &order,
+					  vector<int> &in_degree,
+					  vector<int> &exit_cost);
+
+int switch_exit_cost(const track_graph &graph, int from,
+					 const vector<int> &exit_cost);
+
+void walk_best_path(const track_graph &graph,
+					int starting_switch,
+					const vector<int> &exit_cost,
+					int &best_so_far,
+					vector<int> &best_answer);
+
+bool solve_small_yard(const track_graph &graph,
+					  int starting_switch,
+					  int &best_so_far,
+					  vector<int> &best_answer);
+
+void find_best_routes(const track_graph &graph,
+					  int starting_switch,
+					  const vector<int> &exit_cost,
+					  int most_routes,
+					  bool ties_only,
+					  route_list &routes);
+
+int sidetrack_heap(route_search &search,
+				   const track_graph &graph,
+				   const vector<int> &exit_cost,
+				   int switch_num);
+
+int add_sidetrack(route_search &search, int heap, int delta, int track,
+				  int from);
+
+int merge_sidetracks(route_search &search, int first, int second);
+
+inline int sidetrack_rank(const route_search &search, int node);
+
+void add_found_route(route_search &search,
+					 const track_graph &graph,
+					 int starting_switch,
+					 int taken,
+					 int flips,
+					 route_list &routes);
+
+inline int track_to(int track)
+{
+  return track >> EDGE_SHIFT;
+}
+
+inline bool track_is_default(int track)
+{
+  return (track & EDGE_DEFAULT) != 0;
+}
+
+inline int step_cost(int track)
+{
+  return ((track & EDGE_FORWARD_FLIP) != 0) +
+         ((track & EDGE_BACKWARD_FLIP) != 0);
+}
+
+void update_best_answer(search_state &state, int exit_switch);
+
+void read_track_system(ifstream &infile, track_graph &graph);
+
+bool read_track_system(track_reader &reader, track_graph &graph);
+
+void start_graph(track_graph &graph, int switches_used);
+
+bool open_reader(track_reader &reader, const char *name);
+
+void start_reader(track_reader &reader, int file, const char *name);
+
+void close_reader(track_reader &reader);
+
+inline int peek_char(track_reader &reader);
+
+bool read_number(track_reader &reader, int &value, bool same_line);
+
+bool end_line(track_reader &reader);
+
+bool reader_error(const track_reader &reader, const string &message);
+
+bool read_system_count(track_reader &reader, bool single_system,
+					   int &total_systems);
+
+bool switch_error(const track_reader &reader, int switch_num,
+				  const char *message);
+
+bool map_compiled(track_reader &reader);
+
+bool load_compiled_system(track_reader &reader, track_graph &graph);
+
+bool check_compiled_system(const track_graph &graph, vector<int> &spot,
+						   string &problem);
+
+const int *load_ints(const int *from, int count, vector<int> &values);
+
+bool compiled_error(const track_reader &reader, const string &message);
+
+int compile_yards(const char *input_name,
+				  bool single_system,
+				  const char *output_name);
+
+void write_ints(FILE *file, const vector<int> &values);
+
+void run_parse_benchmark(const char *name);
+
+void solve_track_system(track_system &system, const solve_options &options);
+
+void print_track_system(string &out, const track_system &system);
+
+void append_route(string &out, const track_graph &graph, const int *path,
+				  int length);
+
+void print_routes(string &out, const track_system &system);
+
+void print_start_costs(string &out, const track_system &system,
+					   bool every_switch);
+
+void print_answer(string &out, const track_system &system,
+				  const solve_options &options);
+
+bool report_system(const track_system &system, const char *name);
+
+void append_number(string &out, int value);
+
+void write_output(track_writer &writer, bool flush);
+
+void print_degree_stats(const track_system &system,
+						long long &total_lookups,
+						long long &total_cells);
+
+void solve_in_parallel(vector<track_system> &systems,
+					   const solve_options &options,
+					   int threads);
+
+void make_scale_yard(track_graph &graph, int switches_used);
+
+void run_scale_benchmark();
+
+unsigned int next_random(unsigned int &seed, unsigned int below);
+
+void make_random_yard(track_graph &graph, const yard_shape &shape);
+
+void append_yard(string &out, const track_graph &graph);
+
+void generate_yards(track_writer &writer, yard_shape shape,
+					int total_systems);
+
+void run_phase_benchmark(yard_shape shape);
+
+double lap_ms(chrono::steady_clock::time_point &since);
+
+void solve_yard(solved_yard &yard);
+
+bool set_default(solved_yard &yard, int switch_num, int new_default);
+
+bool close_track(solved_yard &yard, int from, int to);
+
+void mark_with_feeders(solved_yard &yard, int switch_num);
+
+void mark_dirty(solved_yard &yard, int switch_num);
+
+void resolve_yard(solved_yard &yard);
+
+void run_edit_benchmark(yard_shape shape);
+
+void run_route_benchmark(yard_shape shape);
+
+bool update_solver(track_solver *solver);
+
+void fill_route(track_solver *solver, int starting_switch,
+				track_route &route);
+
+bool score_paths(const track_graph &graph,
+				 const int *path,
+				 const int *route_start,
+				 int routes,
+				 route_scores &scores);
+
+inline int find_track(const track_graph &graph, int from, int to);
+
+void run_score_benchmark(yard_shape shape);
+
+int run_server(const char *input_name,
+			   bool single_system,
+			   const char *socket_name);
+
+void stop_serving(int signal_number);
+
+void read_client(serve_client &client, vector<track_system> &systems);
+
+void write_client(serve_client &client);
+
+void answer_query(string &out,
+				  vector<track_system> &systems,
+				  const string &line);
+
+int run_load_test(const char *socket_name,
+				  int queries,
+				  int pipeline,
+				  int yards);
+
+size_t reply_length(const string &in, size_t from);
+
+void clear_stats(search_stats &stats);
+
+void add_stats(search_stats &total, const search_stats &more);
+
+bool open_profile(track_profile &profile, const char *name);
+
+void write_profile(track_profile &profile, const track_system &system);
+
+void close_profile(track_profile &profile);
+
+bool check_route(const track_graph &graph,
+				 int starting_switch,
+				 const string &line,
+				 int &flips,
+				 string &problem);
+
+bool read_expected(const char *name, vector<string> &expected);
+
+int run_check(const char *input_name,
+			  bool single_system,
+			  const char *expect_name,
+			  yard_shape shape,
+			  int generate_systems);
+
+/******************************************************************************
+* main entry point
+* (left out with -DCYMBAL_NO_MAIN, when the solver goes in another program)
+******************************************************************************/
+
+#ifndef CYMBAL_NO_MAIN
+
+/******************************************************************************
+* operator new, operator delete
+* The same as the ones the library comes with, except that every time
+* memory is asked for, allocations goes up by one. It's one add, nowhere
+* near the cost of malloc itself. Everything else (new[], the ones that
+* don't throw) ends up in here too.
+*
+* delete can't be inlined, or g++ sees free being handed memory from new
+* and warns about it. Saying so is a g++ thing, so other compilers skip it.
+******************************************************************************/
+
+void *operator new(size_t size)
+{
+  allocations.fetch_add(1, memory_order_relaxed);
+
+  void *memory = malloc((size > 0) ? size : 1);
+
+  if(memory == NULL)
+    throw bad_alloc();
+
+  return memory;
+}
+
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void *memory) noexcept
+{
+  free(memory);
+}
+
+#ifdef __GNUC__
+__attribute__((noinline))
+#endif
+void operator delete(void *memory, size_t) noexcept
+{
+  free(memory);
+}
+
+int main(int argc, char *argv[])
+{
+  /**************************************************************************
+   * Command line options
+   *
+   * -dfs: Use the original search (solve_for_one_switch) instead
+   *       of the dynamic programming solver. Both print the same routes, so
+   *       this is mostly useful for cross-checking the two against each
+   *       other.
+   *
+   * -memo: Like -dfs, but the search remembers the way out from every
+   *       switch the first time it gets there, so it never goes below one
+   *       twice (solve_for_one_switch_memo). Same routes, without the wait.
+   *
+   * -scale: Don't read cymbal.in. Instead, time the solver on made up yards
+   *       from SCALE_SMALLEST to SCALE_LARGEST switches.
+   *
+   * -stats: After each track system, print to cerr how many degree lookups
+   *       the degree index answered, and how much of the old table would
+   *       have been scanned to answer them.
+   *
+   * -threads N: Read every track system first, then solve them N at a time
+   *       (0 means one for every core). They still print in order.
+   *
+   * -search-threads N: With -dfs, split the search for each system between
+   *       N threads (0 means one for every core). It still prints the
+   *       same route.
+   *
+   * -starts: Instead of Skippy's route, print how many flips it takes to
+   *       get out from every switch that nothing comes into (every place a
+   *       cart could start), one "switch: flips" line each.
+   *
+   * -all-switches: Like -starts, but for every switch in the yard.
+   *
+   * -routes K: Instead of just Skippy's best route, print the K best ones,
+   *       best first, one "flips: route" line each. The first is the same
+   *       route as always, and no route is printed twice.
+   *
+   * -ties: Print every route that throws as few switches as the best one
+   *       (no more than K of them, with -routes K). There can be a lot.
+   *
+   * -no-small: Solve every yard with solve_by_dp, even the ones small
+   *       enough for solve_small_yard. Same routes, just slower, so this is
+   *       mostly for timing the two against each other.
+   *
+   * -budget N: With -dfs, give up searching a system after arriving at N
+   *       switches (SEARCH_BUDGET unless we say), and let -memo find the
+   *       route instead. It's the same route, so this only shows up as a
+   *       note on cerr, but one nasty yard can't hold up the rest of the
+   *       file. 0 means never give up.
+   *
+   * A system that is broken (see check_yard: nowhere to start, a loop, or
+   * a switch set to somewhere it has no track to) isn't printed. What's
+   * wrong with it goes to cerr, the rest are solved like always, and cymbal
+   * exits with 1 at the end.
+   *
+   * -parse-bench: Don't solve anything. Instead, time how fast the input
+   *       can be read with ifstream and with track_reader.
+   *
+   * -i FILE: Read the track systems from FILE instead of cymbal.in. If FILE
+   *       is -, read them from stdin, and send out each answer as soon as
+   *       it's ready, so we can sit in the middle of a pipeline.
+   *
+   * -o FILE: Write the answers to FILE instead of stdout.
+   *
+   * -profile FILE: Write what every track system cost to FILE: how big it
+   *       is, what the search did (see search_stats) and how many
+   *       milliseconds reading, solving and printing it took. It's CSV,
+   *       unless FILE ends in .json.
+   *
+   * -single: The input is one track system without the number of systems
+   *       in front of it, like cymbal001.in through cymbal018.in.
+   *
+   * -generate N: Don't solve anything. Instead, write an input file with N
+   *       made up track systems (to stdout, or -o FILE). What they look like
+   *       is set with:
+   *
+   *       -switches N  switches in each system (100)
+   *       -branches N  most tracks leaving a switch (3)
+   *       -merges P    percent of tracks that merge into a switch something
+   *                    else already runs into (50)
+   *       -forward P   percent of branching switches set forward (90)
+   *       -seed N      where the random numbers start (1)
+   *
+   * -bench: Don't read cymbal.in. Instead, make files full of yards shaped
+   *       like the options above say (except -switches, it tries sizes from
+   *       BENCH_SMALLEST to BENCH_LARGEST) and time reading, solving and
+   *       printing them separately.
+   *
+   * -edit-bench: Don't read cymbal.in. Instead, make yards shaped like
+   *       the -generate options say (from EDIT_BENCH_SMALLEST to
+   *       BENCH_LARGEST switches), keep changing them a little, and time
+   *       bringing the answer up to date against solving them again.
+   *
+   * -route-bench: Like -edit-bench, but time finding the best 1, 10, ...
+   *       ROUTE_BENCH_MOST routes in each yard.
+   *
+   * -score-bench: Like -edit-bench, but time score_paths working out
+   *       what SCORE_BENCH_ROUTES routes through each yard throw.
+   *
+   * -check: Don't print any answers. Instead, solve every system in the
+   *       input (or the -generate N made up ones) with every solver, and
+   *       make sure each printed route really is a way out, is printed
+   *       right, and throws as few switches as the others found. Different
+   *       routes are fine as long as they throw the same number.
+   *
+   * -expect FILE: With -check, also check the routes in FILE (cymbal.out,
+   *       or whatever cymbal.java printed) the same way.
+   *
+   * -serve SOCKET: Don't print any answers. Instead, read and solve the
+   *       track systems (from -i, like always) once, then answer
+   *       questions about them on the Unix socket called SOCKET, until
+   *       Ctrl-C. A question is one line, "N S": the route out of track
+   *       system N for a cart at switch S (or Skippy, if S is 0 or left
+   *       off). The answer is exactly what we'd print for it:
+   *
+   *           Track System N:
+   *           route
+   *           (blank line)
+   *
+   *       or "error: what's wrong" and a blank line. Answers come back in
+   *       the order the questions were asked, so a client can send lots
+   *       of them without waiting for each one. A socket left over at
+   *       SOCKET is replaced, but anything else there is left alone and
+   *       cymbal won't serve.
+   *
+   * -load-test SOCKET: Ask a -serve running on SOCKET -queries N questions
+   *       (LOAD_TEST_QUERIES), keeping -pipeline N of them
+   *       (LOAD_TEST_PIPELINE) waiting at once, going through track
+   *       systems 1 to -yards N (1) from where Skippy starts. Then print
+   *       how many it answered a second, and how long each one took.
+   *       -pipeline 1 is how long one question takes on its own.
+   *
+   * -compile FILE: Don't solve anything. Instead, read the track systems
+   *       (from -i, like always) and write them to FILE as a compiled yard
+   *       file: the tracks, the degree index and the order solve_by_dp
+   *       needs, already worked out. Giving -i a compiled file instead of
+   *       a text one loads it without reading a single number as text
+   *       (but not through a pipe, it has to be mapped into memory).
+   **************************************************************************/
+
+  solve_options options;
+  bool show_stats = false;
+  bool parse_bench = false;
+  bool phase_bench = false;
+  bool edit_bench = false;
+  bool route_bench = false;
+  bool score_bench = false;
+  bool check = false;
+  bool single_system = false;
+  int threads = 1;
+  int generate_systems = 0;
+  int queries = LOAD_TEST_QUERIES;
+  int pipeline = LOAD_TEST_PIPELINE;
+  int yards = 1;
+
+  yard_shape shape;
+
+  shape.switches_used = 100;
+  shape.branches = 3;
+  shape.merge_percent = 50;
+  shape.forward_percent = 90;
+  shape.seed = 1;
+
+  const char *input_name = "cymbal.in";
+  const char *output_name = NULL;
+  const char *expect_name = NULL;
+  const char *profile_name = NULL;
+  const char *compile_name = NULL;
+  const char *serve_name = NULL;
+  const char *load_test_name = NULL;
+
+  options.use_dfs = false;
+  options.memo = false;
+  options.search_threads = 1;
+  options.all_starts = false;
+  options.every_switch = false;
+  options.routes = 0;
+  options.ties = false;
+  options.budget = SEARCH_BUDGET;
+  options.small_yards = true;
+
+  long long total_lookups = 0;
+  long long total_cells = 0;
+
+  for(int arg = 1; arg < argc; arg++)
+  {
+    if(strcmp(argv[arg], "-dfs") == 0)
+      options.use_dfs = true;
+    else if(strcmp(argv[arg], "-memo") == 0)
+    {
+      options.use_dfs = true;
+      options.memo = true;
+    }
+    else if(strcmp(argv[arg], "-stats") == 0)
+      show_stats = true;
+    else if(strcmp(argv[arg], "-starts") == 0)
+      options.all_starts = true;
+    else if(strcmp(argv[arg], "-all-switches") == 0)
+    {
+      options.all_starts = true;
+      options.every_switch = true;
+    }
+    else if( (strcmp(argv[arg], "-routes") == 0) && (arg + 1 < argc) )
+      options.routes = max(atoi(argv[++arg]), 1);
+    else if(strcmp(argv[arg], "-ties") == 0)
+      options.ties = true;
+    else if( (strcmp(argv[arg], "-budget") == 0) && (arg + 1 < argc) )
+      options.budget = max(atoll(argv[++arg]), 0LL);
+    else if(strcmp(argv[arg], "-no-small") == 0)
+      options.small_yards = false;
+    else if( (strcmp(argv[arg], "-threads") == 0) && (arg + 1 < argc) )
+    {
+      threads = atoi(argv[++arg]);
+
+      if(threads <= 0)
+        threads = thread::hardware_concurrency();
+    }
+    else if( (strcmp(argv[arg], "-search-threads") == 0) && (arg + 1 < argc) )
+    {
+      options.search_threads = atoi(argv[++arg]);
+
+      if(options.search_threads <= 0)
+        options.search_threads = thread::hardware_concurrency();
+    }
+    else if(strcmp(argv[arg], "-scale") == 0)
+    {
+      run_scale_benchmark();
+      return 0;
+    }
+    else if(strcmp(argv[arg], "-parse-bench") == 0)
+      parse_bench = true;
+    else if( (strcmp(argv[arg], "-i") == 0) && (arg + 1 < argc) )
+      input_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-o") == 0) && (arg + 1 < argc) )
+      output_name = argv[++arg];
+    else if(strcmp(argv[arg], "-single") == 0)
+      single_system = true;
+    else if( (strcmp(argv[arg], "-profile") == 0) && (arg + 1 < argc) )
+      profile_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-generate") == 0) && (arg + 1 < argc) )
+      generate_systems = max(atoi(argv[++arg]), 1);
+    else if( (strcmp(argv[arg], "-switches") == 0) && (arg + 1 < argc) )
+      shape.switches_used = max(atoi(argv[++arg]), 1);
+    else if( (strcmp(argv[arg], "-branches") == 0) && (arg + 1 < argc) )
+      shape.branches = max(atoi(argv[++arg]), 1);
+    else if( (strcmp(argv[arg], "-merges") == 0) && (arg + 1 < argc) )
+      shape.merge_percent = atoi(argv[++arg]);
+    else if( (strcmp(argv[arg], "-forward") == 0) && (arg + 1 < argc) )
+      shape.forward_percent = atoi(argv[++arg]);
+    else if( (strcmp(argv[arg], "-seed") == 0) && (arg + 1 < argc) )
+      shape.seed = strtoul(argv[++arg], NULL, 10);
+    else if(strcmp(argv[arg], "-bench") == 0)
+      phase_bench = true;
+    else if(strcmp(argv[arg], "-edit-bench") == 0)
+      edit_bench = true;
+    else if(strcmp(argv[arg], "-route-bench") == 0)
+      route_bench = true;
+    else if(strcmp(argv[arg], "-score-bench") == 0)
+      score_bench = true;
+    else if(strcmp(argv[arg], "-check") == 0)
+      check = true;
+    else if( (strcmp(argv[arg], "-expect") == 0) && (arg + 1 < argc) )
+      expect_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-compile") == 0) && (arg + 1 < argc) )
+      compile_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-serve") == 0) && (arg + 1 < argc) )
+      serve_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-load-test") == 0) && (arg + 1 < argc) )
+      load_test_name = argv[++arg];
+    else if( (strcmp(argv[arg], "-queries") == 0) && (arg + 1 < argc) )
+      queries = max(atoi(argv[++arg]), 1);
+    else if( (strcmp(argv[arg], "-pipeline") == 0) && (arg + 1 < argc) )
+      pipeline = max(atoi(argv[++arg]), 1);
+    else if( (strcmp(argv[arg], "-yards") == 0) && (arg + 1 < argc) )
+      yards = max(atoi(argv[++arg]), 1);
+    else
+    {
+      cerr << "usage: " << argv[0]
+           << " [-i FILE|-] [-single] [-o FILE] [-dfs|-memo] [-scale]"
+           << " [-parse-bench] [-starts|-all-switches]"
+           << " [-stats] [-profile FILE] [-threads N] [-search-threads N]"
+           << " [-routes K] [-ties] [-budget N] [-no-small]" << endl
+           << "       " << argv[0]
+           << " -generate N|-bench|-edit-bench|-route-bench|-score-bench"
+           << " [-switches N] [-branches N] [-merges P] [-forward P]"
+           << " [-seed N] [-o FILE]" << endl
+           << "       " << argv[0]
+           << " -check [-i FILE] [-single] [-expect FILE] [-generate N ...]"
+           << endl
+           << "       " << argv[0]
+           << " -compile FILE [-i FILE] [-single]" << endl
+           << "       " << argv[0]
+           << " -serve SOCKET [-i FILE] [-single]" << endl
+           << "       " << argv[0]
+           << " -load-test SOCKET [-queries N] [-pipeline N] [-yards N]"
+           << endl;
+      return 1;
+    }
+  }
+
+  if(parse_bench)
+  {
+    run_parse_benchmark(input_name);
+    return 0;
+  }
+
+  if(phase_bench)
+  {
+    run_phase_benchmark(shape);
+    return 0;
+  }
+
+  if(edit_bench)
+  {
+    run_edit_benchmark(shape);
+    return 0;
+  }
+
+  if(route_bench)
+  {
+    run_route_benchmark(shape);
+    return 0;
+  }
+
+  if(score_bench)
+  {
+    run_score_benchmark(shape);
+    return 0;
+  }
+
+  if(check)
+    return run_check(input_name, single_system, expect_name, shape,
+                     generate_systems);
+
+  if(compile_name != NULL)
+    return compile_yards(input_name, single_system, compile_name);
+
+  if(serve_name != NULL)
+    return run_server(input_name, single_system, serve_name);
+
+  if(load_test_name != NULL)
+    return run_load_test(load_test_name, queries, pipeline, yards);
+
+  /**************************************************************************
+   * Declare the reader and writer and open the files
+   *
+   * streaming: Whether we're reading from stdin. If we are, there's probably
+   *		something waiting on the other end for each answer, so send it
+   *		out right away instead of saving up a whole block.
+   **************************************************************************/
+
+  track_reader reader;
+  track_writer writer;
+  track_profile profile;
+  bool streaming = (strcmp(input_name, "-") == 0);
+
+  writer.file = stdout;
+  writer.buffer.reserve(2 * WRITE_BLOCK);
+
+  if(output_name != NULL)
+  {
+    writer.file = fopen(output_name, "wb");
+
+    if(writer.file == NULL)
+    {
+      cerr << output_name << ": can't write to it" << endl;
+      return 1;
+    }
+  }
+
+  if(generate_systems > 0)
+  {
+    generate_yards(writer, shape, generate_systems);
+    write_output(writer, true);
+
+    if(writer.file != stdout)
+      fclose(writer.file);
+
+    return 0;
+  }
+
+  profile.file = NULL;
+
+  if( (profile_name != NULL) && !open_profile(profile, profile_name) )
+    return 1;
+
+  if(!open_reader(reader, input_name))
+    return 1;
+
+  /**************************************************************************
+   * This is probably one of the harder problems to solve. So, I'm going to
+   * explain the purpose of every single variable here (or try to...)
+   **************************************************************************/
+
+  /**************************************************************************
+   * system
+   * This is everything about the track system we are working on, see
+   * track_system at the top of the file. The most important part is
+   * system.graph, which is how the tracks link the switches together (more
+   * can be found by researching "graph theory").
+   *
+   * for example:
+   * the tracks in graph.out_track from graph.out_start[2] up to
+   * graph.out_start[3] are every switch that switch 2 can roll down to, and
+   * graph.default_setting[2] is the one it is set to.
+   *
+   * Note that the problem is acyclic, meaning you cannot return to a switch
+   * that you've already visited. This is possible because the minecars are
+   * moving due to gravity and we cannot move back up the track.
+   * This means that we don't have to remember where we have been! yey!!
+   *
+   * Also note that the input specification is 1 based, not 0 based like
+   * arrays are in c++/java. Instead of converting back and forth, I'm going
+   * to use 1-based indexing.  So anything at switch 0 doesn't have
+   * relevance to our problem! This should prevent some indexing bugs.
+   **************************************************************************/
+
+  track_system system;
+
+  /**************************************************************************
+   * total_systems: How many systems to solve in this particular file.
+   *
+   * read_ok: Whether everything read so far made sense. If it didn't, we
+   *		solve the systems before the mistake and then give up.
+   *
+   * systems_ok: Whether every system so far could be solved. A broken one
+   *		is just skipped, so this is only for the exit code.
+   **************************************************************************/
+
+  int total_systems;
+  bool read_ok = true;
+  bool systems_ok = true;
+
+  /**************************************************************************
+   * Alright, now that we have all of our variables, let's start on solving
+   * the problem!!!!
+   *
+   * First thing to do? Read in the input.
+   * It makes sense to read in the input for one subproblem at a time, solving
+   * each subproblem and printing it out as we go.  If anything, this will at
+   * least make the output to the judges screen update and might entertain
+   * them long enough to prevent "Time-Limit Exceeded"
+   *
+   * As specificed, the first line indicates the total number of systems. So
+   * read that in, then iterate through all of the track systems.
+   **************************************************************************/
+
+  if(!read_system_count(reader, single_system, total_systems))
+  {
+    close_reader(reader);
+    return 1;
+  }
+
+  /**************************************************************************
+   * Unless we were asked to use more than one thread. The systems don't
+   * have anything to do with each other, so read in a batch of them, hand
+   * them out to the threads, print them in order once they're all done, and
+   * go get the next batch.
+   **************************************************************************/
+
+  if(threads > 1)
+  {
+    vector<track_system> systems;
+    int t_count = 0;
+
+    while(read_ok && (t_count < total_systems))
+    {
+      int batch = min(threads * BATCH_PER_THREAD, total_systems - t_count);
+      int systems_read = 0;
+
+      systems.resize(batch);
+
+      while(read_ok && (systems_read < batch))
+      {
+        chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+
+        systems[systems_read].t_count = t_count + systems_read + 1;
+        read_ok = read_track_system(reader, systems[systems_read].graph);
+        systems[systems_read].parse_ms = lap_ms(clock);
+
+        if(read_ok)
+          systems_read++;
+      }
+
+      systems.resize(systems_read);
+      t_count += systems_read;
+
+      solve_in_parallel(systems, options, threads);
+
+      for(int index = 0; index < systems_read; index++)
+      {
+        if(!report_system(systems[index], input_name))
+          systems_ok = false;
+
+        writer.buffer += systems[index].output;
+        write_output(writer, false);
+
+        if(show_stats)
+          print_degree_stats(systems[index], total_lookups, total_cells);
+
+        if(profile.file != NULL)
+          write_profile(profile, systems[index]);
+      }
+
+      write_output(writer, streaming);
+    }
+  }
+  else
+  {
+    for(int t_count = 1; read_ok && (t_count <= total_systems); t_count++)
+    {
+      /**********************************************************************
+       * Now, we need to read in the input for one track system.
+       **********************************************************************/
+
+      chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+
+      system.t_count = t_count;
+
+      read_ok = read_track_system(reader, system.graph);
+      system.parse_ms = lap_ms(clock);
+
+      if(!read_ok)
+        break;
+
+      /**********************************************************************
+       * Yay, we finished initializing and reading the file for this case!
+       * Now what can we do to help Skippy????
+       *
+       * I'll tell you, solve the best answer!!!
+       **********************************************************************/
+
+      solve_track_system(system, options);
+      system.solve_ms = lap_ms(clock);
+
+      /**********************************************************************
+       * Alright, now we can help Skippy get out! He would be so happy if we
+       * told him the best answer now.... So let's do that!
+       **********************************************************************/
+
+      if(!report_system(system, input_name))
+        systems_ok = false;
+
+      print_answer(writer.buffer, system, options);
+      write_output(writer, streaming);
+      system.print_ms = lap_ms(clock);
+
+      if(show_stats)
+        print_degree_stats(system, total_lookups, total_cells);
+
+      if(profile.file != NULL)
+        write_profile(profile, system);
+
+      /**********************************************************************
+       * YAY! We solved one track system!
+       **********************************************************************/
+    }
+  }
+
+  /**************************************************************************
+   * Closing files is a good practice...
+   **************************************************************************/
+
+  close_reader(reader);
+  write_output(writer, true);
+
+  if(writer.file != stdout)
+    fclose(writer.file);
+
+  if(profile.file != NULL)
+    close_profile(profile);
+
+  if(show_stats)
+  {
+    cerr << "All systems: " << total_lookups << " row scans ("
+         << total_cells << " cells) eliminated" << endl;
+  }
+
+  return (read_ok && systems_ok) ? 0 : 1;
+}
+
+#endif
+
+/******************************************************************************
+* read_track_system
+* Reads one track system from infile into graph.
+*
+* The first line is the number of switches.
+* The next lines are the information for each of those switches
+*
+* The graph doesn't need clearing first, reading a switch fills in all of
+* its tracks.
+*
+* This is the old way of reading, with >> for every number. main uses the
+* track_reader version below now, this one is only kept so -parse-bench
+* has something to compare against.
+******************************************************************************/
+
+void read_track_system(ifstream &infile, track_graph &graph)
+{
+  int total_switches;
+
+  infile >> total_switches;
+
+  start_graph(graph, total_switches);
+
+  for(int s_count = 1; s_count <= total_switches; s_count++)
+  {
+
+    /**********************************************************************
+     * Right now we are dealing with information about switch # s_count
+     *
+     * It is one line: How many connections; The default switch setting;
+     * then the direct connections.
+     **********************************************************************/
+
+    int how_many_connections;
+    int default_setting;
+
+    infile >> default_setting >> how_many_connections;
+
+    /**********************************************************************
+     * Read in how the tracks directly connect this switch to others.
+     **********************************************************************/
+
+    for(int c_count = 1; c_count <= how_many_connections; c_count++)
+    {
+      int temp;
+      infile >> temp;
+
+      graph.out_track.push_back(temp << EDGE_SHIFT);
+    }
+
+    graph.out_start[s_count + 1] = graph.out_track.size();
+
+    /**********************************************************************
+     * Set the default!
+     * finish_switch sorts the tracks and marks the default one if the
+     * switch is looking "forward".
+     **********************************************************************/
+
+    graph.default_setting[s_count] = default_setting;
+
+    finish_switch(graph, s_count);
+  }
+
+  /**************************************************************************
+   * Now that every track is read, we can list the tracks coming into
+   * each switch too, and count them up once so nobody has to count
+   * them again.
+   **************************************************************************/
+
+  build_in_tracks(graph);
+  build_degree_index(graph);
+}
+
+/******************************************************************************
+* read_track_system
+* Reads one track system from reader into graph, the same way as the
+* ifstream version above, except that it checks what it reads. It returns
+* false (after saying what's wrong and where) if:
+*
+*		the file ends in the middle of the system,
+*		something that should be a number isn't,
+*		a switch's default setting or one of its tracks isn't a switch in
+*		this system, or
+*		a switch says it has more or less tracks than its line lists.
+*
+* A compiled file is loaded by load_compiled_system instead.
+******************************************************************************/
+
+bool read_track_system(track_reader &reader, track_graph &graph)
+{
+  int total_switches;
+
+  if(reader.mapped != NULL)
+    return load_compiled_system(reader, graph);
+
+  if(!read_number(reader, total_switches, false))
+    return reader_error(reader, "expected the number of switches");
+
+  if(total_switches < 1)
+    return reader_error(reader, "a track system needs at least one switch");
+
+  if(!end_line(reader))
+    return reader_error(reader, "expected only the number of switches");
+
+  start_graph(graph, total_switches);
+
+  for(int s_count = 1; s_count <= total_switches; s_count++)
+  {
+    int how_many_connections;
+    int default_setting;
+
+    if(!read_number(reader, default_setting, false))
+      return switch_error(reader, s_count,
+                          "'s default setting is missing");
+
+    if(!read_number(reader, how_many_connections, true))
+      return switch_error(reader, s_count,
+                          "'s number of tracks is missing");
+
+    if( (default_setting < 1) || (default_setting > total_switches) )
+      return switch_error(reader, s_count,
+                          "'s default setting is not a switch");
+
+    if(how_many_connections < 0)
+      return switch_error(reader, s_count,
+                          " can't have less than no tracks");
+
+    for(int c_count = 1; c_count <= how_many_connections; c_count++)
+    {
+      int temp;
+
+      if(!read_number(reader, temp, true))
+      {
+        if( (peek_char(reader) != '\n') && (peek_char(reader) != EOF) )
+          return switch_error(reader, s_count,
+                              " has a track that isn't a number");
+
+        return switch_error(reader, s_count,
+                            " lists fewer tracks than it says");
+      }
+
+      if( (temp < 1) || (temp > total_switches) )
+        return switch_error(reader, s_count,
+                            " has a track to a switch that isn't"
+                            " in this system");
+
+      graph.out_track.push_back(temp << EDGE_SHIFT);
+    }
+
+    if(!end_line(reader))
+      return switch_error(reader, s_count,
+                          " lists more tracks than it says");
+
+    graph.out_start[s_count + 1] = graph.out_track.size();
+    graph.default_setting[s_count] = default_setting;
+
+    finish_switch(graph, s_count);
+  }
+
+  build_in_tracks(graph);
+  build_degree_index(graph);
+
+  return true;
+}
+
+/******************************************************************************
+* start_graph
+* Gets graph ready for switches_used switches, with no tracks yet.
+******************************************************************************/
+
+void start_graph(track_graph &graph, int switches_used)
+{
+  graph.switches_used = switches_used;
+  graph.default_setting.assign(switches_used + 1, NOTHING_DONE);
+  graph.out_start.assign(switches_used + 2, 0);
+  graph.out_track.clear();
+  graph.order.clear();
+}
+
+/******************************************************************************
+* open_reader
+* Opens the file called name for reading, or stdin if name is "-". Says so
+* and returns false if it can't.
+*
+* If it's a compiled yard file, it gets mapped into memory (see
+* map_compiled), and read_track_system loads it from there instead.
+******************************************************************************/
+
+bool open_reader(track_reader &reader, const char *name)
+{
+  if(strcmp(name, "-") == 0)
+    start_reader(reader, STDIN_FILENO, "<stdin>");
+  else
+    start_reader(reader, open(name, O_RDONLY), name);
+
+  if(reader.file < 0)
+  {
+    cerr << name << ": can't open it" << endl;
+    return false;
+  }
+
+  if(!map_compiled(reader))
+  {
+    close_reader(reader);
+    return false;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* start_reader
+* Gets reader ready to read from the beginning of a file that's already
+* open.
+******************************************************************************/
+
+void start_reader(track_reader &reader, int file, const char *name)
+{
+  reader.file = file;
+  reader.name = name;
+  reader.buffer.resize(READ_BLOCK);
+  reader.pos = 0;
+  reader.end = 0;
+  reader.line = 1;
+  reader.bytes = 0;
+  reader.mapped = NULL;
+  reader.mapped_size = 0;
+  reader.mapped_pos = 0;
+}
+
+/******************************************************************************
+* close_reader
+* Closing files is a good practice...
+******************************************************************************/
+
+void close_reader(track_reader &reader)
+{
+  if(reader.mapped != NULL)
+    munmap((void *)reader.mapped, reader.mapped_size);
+
+  if(reader.file > STDIN_FILENO)
+    close(reader.file);
+
+  reader.file = -1;
+  reader.mapped = NULL;
+}
+
+/******************************************************************************
+* peek_char
+* Returns the next character in the file without moving past it, or EOF if
+* there isn't one. When we get to the end of the block, read the next one
+* (or as much of it as there is right now, if it's a pipe).
+******************************************************************************/
+
+inline int peek_char(track_reader &reader)
+{
+  if(reader.pos == reader.end)
+  {
+    int got;
+
+    do
+    {
+      got = read(reader.file, &reader.buffer[0], reader.buffer.size());
+    } while( (got < 0) && (errno == EINTR) );
+
+    reader.pos = 0;
+    reader.end = (got > 0) ? got : 0;
+    reader.bytes += reader.end;
+
+    if(reader.end == 0)
+      return EOF;
+  }
+
+  return (unsigned char)reader.buffer[reader.pos];
+}
+
+/******************************************************************************
+* read_number
+* Reads the next number into value. Spaces (and the '\r' from files saved
+* on windows) get skipped. If same_line is true, the number has to be on the
+* line we are on. Otherwise, we skip to the next line that has something on
+* it.
+*
+* Returns false if the next thing isn't a number (or is a number too big to
+* be a switch). By then we might have read part of it, a leading '-' or the
+* digits up to where it went wrong, and we can't step back over those (the
+* block they were in might be gone).
+******************************************************************************/
+
+bool read_number(track_reader &reader, int &value, bool same_line)
+{
+  int next = peek_char(reader);
+
+  while( (next == ' ') || (next == '\t') || (next == '\r') ||
+         ((next == '\n') && !same_line) )
+  {
+    if(next == '\n')
+      reader.line++;
+
+    reader.pos++;
+    next = peek_char(reader);
+  }
+
+  bool negative = (next == '-');
+
+  if(negative)
+  {
+    reader.pos++;
+    next = peek_char(reader);
+  }
+
+  if( (next < '0') || (next > '9') )
+    return false;
+
+  value = 0;
+
+  while( (next >= '0') && (next <= '9') )
+  {
+    value = value * 10 + (next - '0');
+
+    if(value > LARGEST_INPUT)
+      return false;
+
+    reader.pos++;
+    next = peek_char(reader);
+  }
+
+  if( (next != EOF) && (next != ' ') && (next != '\t') && (next != '\r') &&
+      (next != '\n') )
+    return false;
+
+  if(negative)
+    value = -value;
+
+  return true;
+}
+
+/******************************************************************************
+* end_line
+* Moves past the end of the line we are on. Returns false if there's still
+* something other than spaces on it.
+******************************************************************************/
+
+bool end_line(track_reader &reader)
+{
+  int next = peek_char(reader);
+
+  while( (next == ' ') || (next == '\t') || (next == '\r') )
+  {
+    reader.pos++;
+    next = peek_char(reader);
+  }
+
+  if(next == EOF)
+    return true;
+
+  if(next != '\n')
+    return false;
+
+  reader.pos++;
+  reader.line++;
+
+  return true;
+}
+
+/******************************************************************************
+* reader_error
+* Says what's wrong with the input and where, like a compiler would:
+*
+*		cymbal.in:12: switch 3 lists more tracks than it says
+*
+* It always returns false, so it can be returned straight from whatever
+* found the problem.
+******************************************************************************/
+
+bool reader_error(const track_reader &reader, const string &message)
+{
+  cerr << reader.name << ':' << reader.line << ": " << message << endl;
+
+  return false;
+}
+
+/******************************************************************************
+* read_system_count
+* Reads the first line of the input, the number of track systems in it. A
+* file with only one system in it (-single) doesn't have that line. A
+* compiled file always has it, in its header.
+******************************************************************************/
+
+bool read_system_count(track_reader &reader, bool single_system,
+					   int &total_systems)
+{
+  if(reader.mapped != NULL)
+  {
+    total_systems = ((const compiled_header *)reader.mapped)->total_systems;
+    return true;
+  }
+
+  if(single_system)
+  {
+    total_systems = 1;
+    return true;
+  }
+
+  if(!read_number(reader, total_systems, false) || !end_line(reader))
+    return reader_error(reader, "expected the number of track systems");
+
+  return true;
+}
+
+/******************************************************************************
+* switch_error
+* reader_error for something wrong with one switch's line. The message goes
+* right after "switch N".
+******************************************************************************/
+
+bool switch_error(const track_reader &reader, int switch_num,
+				  const char *message)
+{
+  ostringstream out;
+
+  out << "switch " << switch_num << message;
+
+  return reader_error(reader, out.str());
+}
+
+/******************************************************************************
+* map_compiled
+* Checks whether reader's file is a compiled yard file (it starts with
+* COMPILED_MAGIC), and if it is, maps all of it into memory. Text files are
+* left alone, for peek_char to read.
+*
+* Returns false (after saying why) only if it's a compiled file we can't
+* use: one from another version, or from a machine that keeps its numbers
+* the other way around.
+******************************************************************************/
+
+bool map_compiled(track_reader &reader)
+{
+  struct stat info;
+
+  if( (fstat(reader.file, &info) != 0) || !S_ISREG(info.st_mode) ||
+      (info.st_size < (off_t)sizeof(compiled_header)) )
+    return true;
+
+  void *file = mmap(NULL, info.st_size, PROT_READ, MAP_PRIVATE,
+                    reader.file, 0);
+
+  if(file == MAP_FAILED)
+    return true;
+
+  const compiled_header *header = (const compiled_header *)file;
+
+  if(memcmp(header->magic, COMPILED_MAGIC, sizeof(header->magic)) != 0)
+  {
+    munmap(file, info.st_size);
+    return true;
+  }
+
+  reader.mapped = (const char *)file;
+  reader.mapped_size = info.st_size;
+  reader.mapped_pos = sizeof(compiled_header);
+
+  if(header->byte_order != COMPILED_BYTE_ORDER)
+    return compiled_error(reader, "it was compiled on a machine that keeps"
+                          " numbers the other way around");
+
+  if( (header->version != COMPILED_VERSION) ||
+      (header->edge_shift != EDGE_SHIFT) )
+    return compiled_error(reader, "it was compiled by another version of"
+                          " cymbal, compile it again");
+
+  return true;
+}
+
+/******************************************************************************
+* load_compiled_system
+* Loads the next track system in a compiled file into graph. Everything
+* was worked out when it was compiled, so this is just copying each list
+* out of the file, and then making sure nothing in them points outside the
+* system, and that what was worked out really goes with the tracks (see
+* check_compiled_system). That's a look or two at each number, still much
+* less than reading them as text and working it all out again. Returns
+* false, after saying what's wrong, if anything doesn't fit, or the file
+* ends in the middle of the system.
+*
+* The lists get copied out of the mapped file, not used where they are,
+* because the solvers, the cymbal.h edits and -serve all work on
+* track_graph's vectors (and the edits change their sizes). The copies
+* are plain memcpys, a lot quicker than checking what's in them.
+******************************************************************************/
+
+bool load_compiled_system(track_reader &reader, track_graph &graph)
+{
+  compiled_system sizes;
+
+  if(reader.mapped_size - reader.mapped_pos < sizeof(sizes))
+    return compiled_error(reader, "it ends in the middle of a track system");
+
+  memcpy(&sizes, reader.mapped + reader.mapped_pos, sizeof(sizes));
+
+  int switches_used = sizes.switches_used;
+
+  if( (switches_used < 1) || (switches_used > LARGEST_INPUT) ||
+      (sizes.tracks < 0) || (sizes.sources < 0) || (sizes.order < 0) ||
+      (sizes.sources > switches_used) || (sizes.order > switches_used) )
+    return compiled_error(reader, "a track system has sizes that make no"
+                          " sense");
+
+  long long ints = 5LL * switches_used + 7 + 2LL * sizes.tracks +
+                   sizes.sources + sizes.order;
+
+  if( (long long)(reader.mapped_size - reader.mapped_pos - sizeof(sizes)) <
+      ints * (long long)sizeof(int) )
+    return compiled_error(reader, "it ends in the middle of a track system");
+
+  const int *next = (const int *)(reader.mapped + reader.mapped_pos +
+                                  sizeof(sizes));
+
+  graph.switches_used = switches_used;
+
+  next = load_ints(next, switches_used + 1, graph.default_setting);
+  next = load_ints(next, switches_used + 2, graph.out_start);
+  next = load_ints(next, sizes.tracks, graph.out_track);
+  next = load_ints(next, switches_used + 2, graph.in_start);
+  next = load_ints(next, sizes.tracks, graph.in_track);
+  next = load_ints(next, switches_used + 1, graph.out_degree);
+  next = load_ints(next, switches_used + 1, graph.in_degree);
+  next = load_ints(next, sizes.sources, graph.sources);
+  next = load_ints(next, sizes.order, graph.order);
+
+  graph.degree_lookups = NOTHING_DONE;
+
+  /**************************************************************************
+   * Make sure it's a yard we can walk around in without falling off.
+   **************************************************************************/
+
+  bool fits = (graph.out_start[1] == 0) && (graph.in_start[1] == 0) &&
+              (graph.out_start[switches_used + 1] == sizes.tracks) &&
+              (graph.in_start[switches_used + 1] == sizes.tracks);
+
+  for(int sw = 1; fits && (sw <= switches_used); sw++)
+    fits = (graph.out_start[sw] <= graph.out_start[sw + 1]) &&
+           (graph.in_start[sw] <= graph.in_start[sw + 1]) &&
+           (graph.default_setting[sw] >= 1) &&
+           (graph.default_setting[sw] <= switches_used);
+
+  for(int track = 0; fits && (track < sizes.tracks); track++)
+    fits = (track_to(graph.out_track[track]) >= 1) &&
+           (track_to(graph.out_track[track]) <= switches_used) &&
+           (graph.in_track[track] >= 1) &&
+           (graph.in_track[track] <= switches_used);
+
+  for(int index = 0; fits && (index < sizes.sources); index++)
+    fits = (graph.sources[index] >= 1) &&
+           (graph.sources[index] <= switches_used);
+
+  for(int index = 0; fits && (index < sizes.order); index++)
+    fits = (graph.order[index] >= 1) && (graph.order[index] <= switches_used);
+
+  if(!fits)
+    return compiled_error(reader, "a track system points at switches it"
+                          " doesn't have");
+
+  if( (sizes.order != 0) && (sizes.order != switches_used) )
+    return compiled_error(reader, "a track system's order isn't all of its"
+                          " switches");
+
+  string problem;
+
+  if(!check_compiled_system(graph, reader.spot, problem))
+    return compiled_error(reader, "a track system's " + problem);
+
+  reader.mapped_pos += sizeof(sizes) + ints * sizeof(int);
+
+  return true;
+}
+
+/******************************************************************************
+* check_compiled_system
+* Makes sure everything a compiled file worked out ahead of time is what
+* build_in_tracks, build_degree_index and check_yard would have worked out
+* from its tracks, since the solvers believe it without looking. A file
+* that's been changed by hand (or by a bad disk) could otherwise send them
+* around a loop, or off the end of a list. Once load_compiled_system knows
+* every number points at a real switch, this checks that:
+*
+*		out_degree and in_degree are how many tracks each list has,
+*		each switch's tracks are sorted, with no track twice, and their
+*		cost bits are what track_cost_bits says,
+*		in_track is out_track turned around, in the order
+*		build_in_tracks would have put it in,
+*		sources is every switch with nothing coming into it, in order, and
+*		order (if there is one) has every switch once, and every track
+*		goes from a switch to one later in it, so there's no loop.
+*
+* spot is where each switch's in list has been filled up to, and then
+* where each switch is in the order. Returns false, with the rest of a
+* sentence that starts "a track system's" in problem, if anything's off.
+******************************************************************************/
+
+bool check_compiled_system(const track_graph &graph, vector<int> &spot,
+						   string &problem)
+{
+  int switches_used = graph.switches_used;
+
+  for(int sw = 1; sw <= switches_used; sw++)
+  {
+    if( (graph.out_degree[sw] != graph.out_start[sw + 1] -
+                                 graph.out_start[sw]) ||
+        (graph.in_degree[sw] != graph.in_start[sw + 1] - graph.in_start[sw]) )
+    {
+      problem = "degree index doesn't match its tracks";
+      return false;
+    }
+  }
+
+  spot.assign(graph.in_start.begin(), graph.in_start.end());
+
+  for(int from = 1; from <= switches_used; from++)
+  {
+    for(int track = graph.out_start[from]; track < graph.out_start[from + 1];
+        track++)
+    {
+      int word = graph.out_track[track];
+      int to = track_to(word);
+
+      if( (track > graph.out_start[from]) &&
+          (track_to(graph.out_track[track - 1]) >= to) )
+      {
+        problem = "tracks aren't sorted";
+        return false;
+      }
+
+      if( (track_is_default(word) != (graph.default_setting[from] == to)) ||
+          (track_cost_bits(graph, from, word) != word) )
+      {
+        problem = "tracks have the wrong costs";
+        return false;
+      }
+
+      if( (spot[to] == graph.in_start[to + 1]) ||
+          (graph.in_track[spot[to]] != from) )
+      {
+        problem = "in tracks aren't its tracks turned around";
+        return false;
+      }
+
+      spot[to]++;
+    }
+  }
+
+  int source = 0;
+  bool sources_match = true;
+
+  for(int sw = 1; sw <= switches_used; sw++)
+  {
+    if(graph.in_degree[sw] == 0)
+    {
+      sources_match = sources_match &&
+                      (source < (int)graph.sources.size()) &&
+                      (graph.sources[source] == sw);
+      source++;
+    }
+  }
+
+  if(!sources_match || (source != (int)graph.sources.size()))
+  {
+    problem = "sources aren't the switches nothing comes into";
+    return false;
+  }
+
+  if(graph.order.empty())
+    return true;
+
+  spot.assign(switches_used + 1, NOT_REMEMBERED);
+
+  for(int index = 0; index < switches_used; index++)
+  {
+    if(spot[graph.order[index]] != NOT_REMEMBERED)
+    {
+      problem = "order has a switch in it twice";
+      return false;
+    }
+
+    spot[graph.order[index]] = index;
+  }
+
+  for(int from = 1; from <= switches_used; from++)
+    for(int track = graph.out_start[from]; track < graph.out_start[from + 1];
+        track++)
+      if(spot[track_to(graph.out_track[track])] <= spot[from])
+      {
+        problem = "order isn't downhill (it might be a loop)";
+        return false;
+      }
+
+  return true;
+}
+
+/******************************************************************************
+* load_ints
+* Copies count ints starting at from into values, and returns where the
+* next list starts.
+******************************************************************************/
+
+const int *load_ints(const int *from, int count, vector<int> &values)
+{
+  values.assign(from, from + count);
+
+  return from + count;
+}
+
+/******************************************************************************
+* compiled_error
+* reader_error for a compiled file. There are no lines in it, so it says
+* how far into the file the problem is instead:
+*
+*		yard.bin: byte 1024: it ends in the middle of a track system
+******************************************************************************/
+
+bool compiled_error(const track_reader &reader, const string &message)
+{
+  cerr << reader.name << ": byte " << reader.mapped_pos << ": " << message
+       << endl;
+
+  return false;
+}
+
+/******************************************************************************
+* compile_yards
+* For -compile: reads every track system in the file called input_name and
+* writes them to output_name as a compiled yard file (see compiled_header).
+* Each one goes through check_yard here, which works out the order it gets
+* solved in, once, so loading it never has to.
+*
+* If the input has a mistake in it, or a broken system, there's no file at
+* all afterwards, instead of one that stops early. Returns what main
+* should: 0 if it worked.
+******************************************************************************/
+
+int compile_yards(const char *input_name,
+				  bool single_system,
+				  const char *output_name)
+{
+  track_reader reader;
+  track_graph graph;
+  compiled_header header;
+  int total_systems;
+
+  vector<int> in_degree;
+
+  if(!open_reader(reader, input_name))
+    return 1;
+
+  if(!read_system_count(reader, single_system, total_systems))
+  {
+    close_reader(reader);
+    return 1;
+  }
+
+  FILE *file = fopen(output_name, "wb");
+
+  if(file == NULL)
+  {
+    cerr << output_name << ": can't write to it" << endl;
+    close_reader(reader);
+    return 1;
+  }
+
+  memcpy(header.magic, COMPILED_MAGIC, sizeof(header.magic));
+  header.version = COMPILED_VERSION;
+  header.byte_order = COMPILED_BYTE_ORDER;
+  header.edge_shift = EDGE_SHIFT;
+  header.total_systems = total_systems;
+
+  fwrite(&header, sizeof(header), 1, file);
+
+  bool read_ok = true;
+
+  for(int t_count = 1; read_ok && (t_count <= total_systems); t_count++)
+  {
+    read_ok = read_track_system(reader, graph);
+
+    if(!read_ok)
+      break;
+
+    string problem;
+
+    if(!check_yard(graph, in_degree, problem))
+    {
+      cerr << input_name << ": Track System " << t_count << ": " << problem
+           << endl;
+      read_ok = false;
+      break;
+    }
+
+    compiled_system sizes;
+
+    sizes.switches_used = graph.switches_used;
+    sizes.tracks = graph.out_track.size();
+    sizes.sources = graph.sources.size();
+    sizes.order = graph.order.size();
+
+    fwrite(&sizes, sizeof(sizes), 1, file);
+
+    write_ints(file, graph.default_setting);
+    write_ints(file, graph.out_start);
+    write_ints(file, graph.out_track);
+    write_ints(file, graph.in_start);
+    write_ints(file, graph.in_track);
+    write_ints(file, graph.out_degree);
+    write_ints(file, graph.in_degree);
+    write_ints(file, graph.sources);
+    write_ints(file, graph.order);
+  }
+
+  close_reader(reader);
+
+  if(read_ok && (ferror(file) != 0))
+  {
+    cerr << output_name << ": can't write to it" << endl;
+    read_ok = false;
+  }
+
+  fclose(file);
+
+  if(!read_ok)
+    remove(output_name);
+
+  return read_ok ? 0 : 1;
+}
+
+/******************************************************************************
+* write_ints
+* Writes every int in values to file, the way they sit in memory.
+******************************************************************************/
+
+void write_ints(FILE *file, const vector<int> &values)
+{
+  if(!values.empty())
+    fwrite(&values[0], sizeof(int), values.size(), file);
+}
+
+/******************************************************************************
+* solve_track_system
+* Finds where Skippy starts and the best way out for one track system.
+*
+* Before we can start solving anything, we need to initialize the
+* answers! This is definately a good idea!
+*
+* Set the answers to something! The path starts out empty.
+*
+* As for the best_number, just set it to some insanely large number.
+* Doing this will allow the worst answer to overwrite the initialized
+* values (assuming our large number is larger than the worst answer).
+*
+* Now what you don't know (or maybe you do?), even if there are more
+* than one answer, we should just find an answer it and print that!
+* Think about it, he wants to get out as fast a possible.  He doesn't
+* care which "best" path he takes, he wants to know something fast!
+*
+* I'm going to use dynamic programming (or, with -dfs, a depth first
+* search, maybe split between threads) to solve this, read the comments
+* above the functions to understand how they work.... All you need to
+* know by looking here is that we are going from starting_switch to the
+* exit and storing the best answer that we get in best_answer.
+*
+* To do this, we need to send in:
+*		How everything is connected
+*		Where to start
+*		The lowest answer so far (remember: we set it to a big number)
+*		The best actual answer (so we can write to it)
+******************************************************************************/
+
+void solve_track_system(track_system &system, const solve_options &options)
+{
+  system.lowest_switches = LARGE_NUMBER;
+  system.best_answer.clear();
+  system.gave_up = false;
+  clear_stats(system.graph.stats);
+
+  system.starting_switch = get_starting(system.graph);
+
+  bool more_routes = (options.routes > 0) || options.ties;
+
+  /**************************************************************************
+   * Most yards are small, and for those there's a quicker way to do all of
+   * this (checking the yard too). If it finds anything wrong, it leaves
+   * the yard to the rest of this function, which says what.
+   **************************************************************************/
+
+  if( !options.use_dfs && !options.all_starts && !more_routes &&
+      options.small_yards &&
+      solve_small_yard(system.graph, system.starting_switch,
+                       system.lowest_switches, system.best_answer) )
+  {
+    system.problem.clear();
+    return;
+  }
+
+  /**************************************************************************
+   * A broken yard could send the solvers around a loop forever, so make
+   * sure it isn't one first. That also works out the order solve_by_dp
+   * needs, so it doesn't cost much.
+   **************************************************************************/
+
+  if(!check_yard(system.graph, system.in_degree, system.problem))
+    return;
+
+  /**************************************************************************
+   * Unless it's the depth first search, every switch's cost comes from the
+   * one sweep up the hill solve_by_dp makes (into the system's own working
+   * space, so nothing has to ask for memory). Skippy's route can then be
+   * read straight off of it, and so can the costs from every other start.
+   * Finding more than one route starts from there too.
+   **************************************************************************/
+
+  if(!options.use_dfs || options.all_starts || more_routes)
+    solve_all_starts(system.graph, system.order, system.in_degree,
+                     system.exit_cost);
+
+  if(options.use_dfs && options.memo)
+  {
+    solve_for_one_switch_memo(system.graph, system.starting_switch,
+                              system.lowest_switches, system.best_answer);
+  }
+  else if(options.use_dfs && (options.search_threads > 1))
+  {
+    system.gave_up =
+      !solve_for_one_switch_threaded(system.graph, system.starting_switch,
+                                     system.lowest_switches,
+                                     system.best_answer,
+                                     options.search_threads, options.budget);
+  }
+  else if(options.use_dfs)
+  {
+    system.gave_up =
+      !solve_for_one_switch(system.graph, system.starting_switch,
+                            system.lowest_switches, system.best_answer,
+                            options.budget);
+  }
+  else
+  {
+    walk_best_path(system.graph, system.starting_switch, system.exit_cost,
+                   system.lowest_switches, system.best_answer);
+  }
+
+  /**************************************************************************
+   * If the search ran out of budget, what it found so far might not be the
+   * best, so get the real answer the quick way. It's the same route the
+   * search would have found if it had kept going.
+   **************************************************************************/
+
+  if(system.gave_up)
+  {
+    solve_for_one_switch_memo(system.graph, system.starting_switch,
+                              system.lowest_switches, system.best_answer);
+  }
+
+  if(more_routes)
+  {
+    find_best_routes(system.graph, system.starting_switch, system.exit_cost,
+                     (options.routes > 0) ? options.routes : LARGE_NUMBER,
+                     options.ties, system.routes);
+  }
+}
+
+/******************************************************************************
+* print_track_system
+* Prints the "Track System N:" block for a solved system onto the end of
+* out.
+******************************************************************************/
+
+void print_track_system(string &out, const track_system &system)
+{
+  out += "Track System ";
+  append_number(out, system.t_count);
+  out += ":\n";
+
+  append_route(out, system.graph, system.best_answer.data(),
+               system.best_answer.size());
+
+  out += "\n\n";
+}
+
+/******************************************************************************
+* append_route
+* Prints the route that rolls over the length switches in path (the first
+* one is where the cart starts) onto the end of out, the way the problem
+* wants it.
+*
+* How, you ask? Well it's kind of complicated. We have the path stored
+* in path, but Skippy wants to know which switches to throw!
+* Drats! Where's the fun in that!
+*
+* Ok, we want to go through all of the switches in the path, one at a
+* time.
+*
+* I start off by setting the current switch equal to the second switch
+* and the last switch equal to the starting_switch.
+*
+* Now for every possible set of 2 switches located directly next to
+* each other (ie, current and last), we can look up if we should print
+* either one of the or both of them. How?
+*
+* If the last switch has more than one output, It is looking at the
+* current switch, so we need to print it because we could not determine
+* what to print last time around.  So we can check if it connects to
+* this switch by default. If it does, then we dont need to print (x),
+* we will need to print (x) to indicate a switch has been thrown.
+*
+* If the current switch connects many tracks to one, we need to print
+* it right away!!! We need to look at the switch setting of the last
+* switch. If it is not the default, print it with (x). Otherwise, we
+* just print the switch like normal.
+*
+* Note that once we print the value, it will not be printed as a
+* again even though it goes through the printing conditionals twice!
+* This is because a switch can look "forward" or "backward", but it
+* can NOT be both!
+******************************************************************************/
+
+void append_route(string &out, const track_graph &graph, const int *path,
+				  int length)
+{
+  int path_index = 1;
+  int last_switch = path[0];
+  int current_switch;
+
+  while(path_index < length)
+  {
+    current_switch = path[path_index];
+
+    int temp_val;
+
+    /**********************************************************************
+     * Here's the code for a switch that comes from one track and goes
+     * to more than one. (A "forward" switch.)
+     **********************************************************************/
+
+    temp_val = connects_to_x(graph, last_switch, graph.degree_lookups);
+    if(temp_val > 1)
+    {
+      append_number(out, last_switch);
+
+      if(graph.default_setting[last_switch] != current_switch)
+      {
+        out += '(';
+        append_number(out, current_switch);
+        out += ')';
+      }
+
+      out += ' ';
+    }
+
+    /**********************************************************************
+     * Here's the code for a switch that comes from any number of tracks
+     * and either leaves the system or travels along one track.
+     * (A "backward" switch).
+     **********************************************************************/
+
+    temp_val = connects_to_x(graph, current_switch, graph.degree_lookups);
+    if(temp_val <= 1)
+    {
+      if(graph.default_setting[current_switch] != last_switch)
+      {
+        out += '(';
+        append_number(out, last_switch);
+        out += ')';
+      }
+
+      append_number(out, current_switch);
+
+      out += ' ';
+    }
+
+    last_switch = current_switch;
+    path_index++;
+  }
+}
+
+/******************************************************************************
+* print_routes
+* For -routes and -ties: prints the "Track System N:" block with one line
+* for every route find_best_routes found, best first:
+*
+*		flips: route
+*
+* with the route printed just like print_track_system prints it.
+******************************************************************************/
+
+void print_routes(string &out, const track_system &system)
+{
+  const route_list &routes = system.routes;
+
+  out += "Track System ";
+  append_number(out, system.t_count);
+  out += ":\n";
+
+  for(int route = 0; route < (int)routes.flips.size(); route++)
+  {
+    append_number(out, routes.flips[route]);
+    out += ": ";
+
+    append_route(out, system.graph, &routes.switches[routes.start[route]],
+                 routes.start[route + 1] - routes.start[route]);
+
+    out += '\n';
+  }
+
+  out += '\n';
+}
+
+/******************************************************************************
+* print_start_costs
+* For -starts: prints the "Track System N:" block with one "switch: flips"
+* line for every switch nothing comes into (or, with every_switch, every
+* switch), instead of Skippy's route. A cart starting at a switch hasn't
+* come in on any track, so just like Skippy, the switch it starts on never
+* needs throwing backward - which is exactly what exit_cost counts.
+******************************************************************************/
+
+void print_start_costs(string &out, const track_system &system,
+					   bool every_switch)
+{
+  const track_graph &graph = system.graph;
+
+  out += "Track System ";
+  append_number(out, system.t_count);
+  out += ":\n";
+
+  for(int sw = 1; sw <= graph.switches_used; sw++)
+  {
+    if(!every_switch && (graph.in_degree[sw] != 0))
+      continue;
+
+    append_number(out, sw);
+    out += ": ";
+
+    if(system.exit_cost[sw] >= LARGE_NUMBER)
+      out += '-';
+    else
+      append_number(out, system.exit_cost[sw]);
+
+    out += '\n';
+  }
+
+  out += '\n';
+}
+
+/******************************************************************************
+* print_answer
+* Prints a solved system the way options asked for: the route, the best
+* few routes, or with all_starts, the costs from every start. A broken
+* system (see check_yard) prints nothing at all.
+******************************************************************************/
+
+void print_answer(string &out, const track_system &system,
+				  const solve_options &options)
+{
+  if(!system.problem.empty())
+    return;
+
+  if(options.all_starts)
+    print_start_costs(out, system, options.every_switch);
+  else if( (options.routes > 0) || options.ties )
+    print_routes(out, system);
+  else
+    print_track_system(out, system);
+}
+
+/******************************************************************************
+* report_system
+* Says on cerr if anything went wrong with a solved system from the file
+* called name: it's broken (so it wasn't solved), or the depth first search
+* ran out of budget (so solve_for_one_switch_memo finished it). Returns
+* false if it's broken.
+*
+*		cymbal.in: Track System 3: switch 7 is on a loop
+******************************************************************************/
+
+bool report_system(const track_system &system, const char *name)
+{
+  if(!system.problem.empty())
+  {
+    cerr << name << ": Track System " << system.t_count << ": "
+         << system.problem << endl;
+    return false;
+  }
+
+  if(system.gave_up)
+  {
+    cerr << name << ": Track System " << system.t_count << ": the search"
+         << " ran out of -budget, -memo finished it" << endl;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* append_number
+* Puts value (never negative) on the end of out. The digits come out
+* backwards, so they go into a little array first.
+******************************************************************************/
+
+void append_number(string &out, int value)
+{
+  char digits[12];
+  int count = 0;
+
+  do
+  {
+    digits[count++] = '0' + value % 10;
+    value /= 10;
+  } while(value > 0);
+
+  while(count > 0)
+    out += digits[--count];
+}
+
+/******************************************************************************
+* write_output
+* Sends the writer's buffer to its file once there's at least WRITE_BLOCK
+* of it, or right away if flush is true (at the very end).
+******************************************************************************/
+
+void write_output(track_writer &writer, bool flush)
+{
+  if( (writer.buffer.size() < (size_t)WRITE_BLOCK) && !flush )
+    return;
+
+  fwrite(writer.buffer.data(), 1, writer.buffer.size(), writer.file);
+  writer.buffer.clear();
+
+  if(flush)
+    fflush(writer.file);
+}
+
+/******************************************************************************
+* print_degree_stats
+* For -stats, say how much work the degree index saved. With the old
+* table, every degree lookup scanned a row of switches_used, and
+* get_starting scanned a whole column for every switch up to the start.
+******************************************************************************/
+
+void print_degree_stats(const track_system &system,
+						long long &total_lookups,
+						long long &total_cells)
+{
+  const track_graph &graph = system.graph;
+
+  long long cells = (graph.degree_lookups + system.starting_switch) *
+                    (long long)graph.switches_used;
+
+  cerr << "Track System " << system.t_count << ": " << graph.degree_lookups
+       << " degree lookups, " << graph.degree_lookups << " row scans and "
+       << system.starting_switch << " column scans (" << cells
+       << " cells) eliminated" << endl;
+
+  total_lookups += graph.degree_lookups;
+  total_cells += cells;
+}
+
+/******************************************************************************
+* solve_in_parallel
+* Solves (and prints into their output strings) every system in systems,
+* using the given number of threads.
+*
+* The systems are handed out one at a time from a shared counter, so a
+* thread that gets a few big yards doesn't hold everyone else up. Nothing
+* else is shared: each system is only ever touched by the thread that took
+* it, and it is printed into its own string instead of the writer.
+******************************************************************************/
+
+void solve_in_parallel(vector<track_system> &systems,
+					   const solve_options &options,
+					   int threads)
+{
+  atomic<int> next_system(0);
+  vector<thread> workers;
+
+  for(int worker = 0; worker < threads; worker++)
+  {
+    workers.push_back(thread([&systems, &next_system, &options]()
+    {
+      int index;
+
+      while((index = next_system++) < (int)systems.size())
+      {
+        chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+
+        solve_track_system(systems[index], options);
+        systems[index].solve_ms = lap_ms(clock);
+
+        systems[index].output.clear();
+        print_answer(systems[index].output, systems[index], options);
+        systems[index].print_ms = lap_ms(clock);
+      }
+    }));
+  }
+
+  for(int worker = 0; worker < threads; worker++)
+    workers[worker].join();
+}
+
+/******************************************************************************
+* finish_switch
+* Called once all of the tracks leaving switch_num have been read in.
+*
+* The searches try tracks in order of switch number (that's how ties get
+* broken), so sort them. The input shouldn't list a track twice, but if it
+* does we only keep one, just like writing the same spot of a table twice.
+* Then, if the switch is looking "forward" down one of these tracks, mark
+* that track as the default.
+******************************************************************************/
+
+void finish_switch(track_graph &graph, int switch_num)
+{
+  vector<int>::iterator first = graph.out_track.begin() +
+                                graph.out_start[switch_num];
+  vector<int>::iterator last = graph.out_track.end();
+
+  sort(first, last);
+  last = unique(first, last);
+
+  graph.out_track.erase(last, graph.out_track.end());
+  graph.out_start[switch_num + 1] = graph.out_track.size();
+
+  for(vector<int>::iterator track = first; track != last; track++)
+    if(track_to(*track) == graph.default_setting[switch_num])
+      *track |= EDGE_DEFAULT;
+}
+
+/******************************************************************************
+* build_in_tracks
+* Fills in in_start and in_track from the out tracks. First count how many
+* tracks come into each switch, then add up the counts to find where each
+* switch's list starts, then drop every track into its spot. Because we go
+* through the switches in order, each in list ends up sorted too.
+*
+* Dropping a track into switch B's list moves in_start[B] up one, so at the
+* end in_start[B] is where B + 1's list starts. Moving everything over by
+* one spot puts it back, without needing another array to count in.
+******************************************************************************/
+
+void build_in_tracks(track_graph &graph)
+{
+  int switches_used = graph.switches_used;
+
+  graph.in_start.assign(switches_used + 2, 0);
+  graph.in_track.resize(graph.out_track.size());
+
+  for(int track = 0; track < graph.out_start[switches_used + 1]; track++)
+    graph.in_start[track_to(graph.out_track[track]) + 1]++;
+
+  for(int sw = 1; sw <= switches_used + 1; sw++)
+    graph.in_start[sw] += graph.in_start[sw - 1];
+
+  for(int from = 1; from <= switches_used; from++)
+    for(int track = graph.out_start[from];
+        track < graph.out_start[from + 1]; track++)
+      graph.in_track[graph.in_start[track_to(graph.out_track[track])]++] =
+        from;
+
+  for(int sw = switches_used + 1; sw >= 1; sw--)
+    graph.in_start[sw] = graph.in_start[sw - 1];
+
+  graph.in_start[0] = 0;
+}
+
+/******************************************************************************
+* build_degree_index
+* Counts the tracks leaving and coming into every switch and lists the
+* switches that nothing comes into. The in-degrees also give the dynamic
+* programming solver its starting point for the topological order.
+*
+* Once every out-degree is known, what each track costs can be worked out
+* too, and kept in the track itself (see track_cost_bits).
+******************************************************************************/
+
+void build_degree_index(track_graph &graph)
+{
+  int switches_used = graph.switches_used;
+
+  graph.out_degree.assign(switches_used + 1, NOTHING_DONE);
+  graph.in_degree.assign(switches_used + 1, NOTHING_DONE);
+  graph.sources.clear();
+  graph.degree_lookups = 0;
+
+  for(int sw = 1; sw <= switches_used; sw++)
+  {
+    graph.out_degree[sw] = graph.out_start[sw + 1] - graph.out_start[sw];
+    graph.in_degree[sw] = graph.in_start[sw + 1] - graph.in_start[sw];
+
+    if(graph.in_degree[sw] == 0)
+      graph.sources.push_back(sw);
+  }
+
+  for(int from = 1; from <= switches_used; from++)
+    for(int track = graph.out_start[from];
+        track < graph.out_start[from + 1]; track++)
+      graph.out_track[track] = track_cost_bits(graph, from,
+                                               graph.out_track[track]);
+}
+
+/******************************************************************************
+* track_cost_bits
+* Returns track (which leaves from_switch) with EDGE_FORWARD_FLIP and
+* EDGE_BACKWARD_FLIP set to what rolling down it costs. These are the same
+* two checks solve_for_one_switch makes:
+*
+* Going "forward" off of a switch with more than one exit costs a flip unless
+* the track is the default one.
+*
+* Rolling onto a switch with one (or zero) exits costs a flip if that switch
+* isn't set back to the track we came in on.
+*
+* Both depend on the switches at either end, not just the track, but once
+* they're in the track, step_cost is two bit tests. solve_by_dp looks at
+* every track, so it gets to skip two out-degrees and a default setting
+* (usually nowhere near each other in memory) for each one.
+******************************************************************************/
+
+int track_cost_bits(const track_graph &graph, int from_switch, int track)
+{
+  int to_switch = track_to(track);
+
+  track &= ~(EDGE_FORWARD_FLIP | EDGE_BACKWARD_FLIP);
+
+  if( (graph.out_degree[from_switch] > 1) && !track_is_default(track) )
+    track |= EDGE_FORWARD_FLIP;
+
+  if( (graph.out_degree[to_switch] <= 1) &&
+      (graph.default_setting[to_switch] != from_switch) )
+    track |= EDGE_BACKWARD_FLIP;
+
+  return track;
+}
+
+/******************************************************************************
+* mark_track_costs
+* Works out the cost bits again for every track that switch_num's default
+* setting or out-degree has anything to do with: the ones leaving it, and
+* the ones coming into it (found in their own switch's list, which is
+* sorted, so it's a binary search).
+******************************************************************************/
+
+void mark_track_costs(track_graph &graph, int switch_num)
+{
+  for(int track = graph.out_start[switch_num];
+      track < graph.out_start[switch_num + 1]; track++)
+    graph.out_track[track] = track_cost_bits(graph, switch_num,
+                                             graph.out_track[track]);
+
+  for(int in = graph.in_start[switch_num];
+      in < graph.in_start[switch_num + 1]; in++)
+  {
+    int from = graph.in_track[in];
+
+    vector<int>::iterator track =
+      lower_bound(graph.out_track.begin() + graph.out_start[from],
+                  graph.out_track.begin() + graph.out_start[from + 1],
+                  switch_num << EDGE_SHIFT);
+
+    *track = track_cost_bits(graph, from, *track);
+  }
+}
+
+/******************************************************************************
+* get_starting
+* We figure out the starting point by simply looking at which switches
+* nothing connects to. When we find an answer, we simply return it, because
+* Skippy cannot be at more than one switch right now. build_degree_index
+* already found them, in order, so just take the first one.
+******************************************************************************/
+
+int get_starting(const track_graph &graph)
+{
+  if(!graph.sources.empty())
+    return graph.sources[0];
+
+  /**************************************************************************
+   * We should NEVER get to this line, but C++ likes to complain about missing
+   * return statements, so in the bizarre case that we don't find the start
+   * switch, we are gauranteed that switch 1 exists! So just return it as the
+   * first one.
+   **************************************************************************/
+
+  return 1;
+}
+
+/******************************************************************************
+* solve_for_one_switch
+* Wow, how to explain this one??? First off: It has a lot of arguments...
+*
+* graph:           How the tracks connect switches.
+*
+* starting_switch: Where Skippy is.
+*
+* best_so_far:     Lowest number of switches thrown in all previous solutions.
+*                  Note that we need to overwrite this value as we go!
+*
+* best_answer:     The path of the best answer we've found so far.
+*
+* How does this work??? I really hope I can put this in english...
+*
+* We don't need to know how the entire system connects to solve this problem.
+* All we need to know is how to get from the point A to B if A and B are
+* directly connected. So that's what I'm doing. We start at starting_switch
+* with NOTHING_DONE as the last switch. So first time around, we try to go
+* from the start to everything that it can directly connect to.
+* If we throw a switch, we let the system know...
+*
+* By doing this, we can keep track of how many switches we have to throw to
+* get all the way to the exit. Because Skippy constantly moves downhill and
+* there are no dead ends (it would be an exit), We will connect every switch
+* that we are able to get to to everything else and eventually find the exit.
+* We will keept track of the total number of switches thrown so far by simply
+* adding the 0 or 1 to get from every switch on the path.
+*
+* example: 1 connects to 2, 3. It defaults to 2.
+*
+* We first say, "ok, we can get to 2 without flipping a switch, so start from
+* switch 2 and see if we can get out of the track system from switch two."
+*
+* Likewise, we try from switch 3, but we say "we threw one more switch to get
+* to 3, so remember that".
+*
+* The only other kicker, we have to look "backwards" as we travel on a track.
+* We have to make sure that a "many-to-one" switch is defaulted to the track
+* that we came from. If the last track is NOTHING_DONE, that's no biggie. But,
+* that only happens at the start, so we need to increment the switch count
+* if we look "backwards" and realize that a switch was throw to get here.
+* That part lives in arrive_at_switch (and backward_cost).
+*
+* This used to call itself once per switch on the path, but a yard with a
+* long enough downhill chain would run out of stack doing that. So instead
+* "answer" is our own stack: one search_frame for every switch on the path
+* we are trying right now, and each frame remembers which of its tracks to
+* try next. All of that lives in a search_state, and the loop that walks it
+* is continue_search, so a search split between threads can use the same
+* code (see solve_for_one_switch_threaded).
+*
+* On some yards there are just too many paths, even with the pruning. So
+* the search only gets to arrive at "budget" switches (0 means as many as
+* it takes) before it gives up and returns false. Otherwise it returns
+* true.
+*
+* My last remark, by the time we get through this function, "answer" will have
+* taken the value of a lot of possible paths (possibly longer than the best
+* answer). I'm just saying this to help readers understand how this works.
+******************************************************************************/
+
+bool solve_for_one_switch(const track_graph &graph,
+						  int starting_switch,
+						  int &best_so_far,
+						  vector<int> &best_answer,
+						  long long budget)
+{
+  search_state state;
+
+  state.best_so_far = best_so_far;
+  state.best_shared = 0;
+  state.incumbent = NULL;
+  state.task = 0;
+  state.budget = budget;
+  state.gave_up = false;
+  state.degree_lookups = 0;
+  clear_stats(state.stats);
+
+  arrive_at_switch(graph, state, NOTHING_DONE, starting_switch, NOTHING_DONE);
+
+  continue_search(graph, state);
+
+  best_so_far = state.best_so_far;
+  best_answer.swap(state.best_answer);
+  add_stats(graph.stats, state.stats);
+  graph.degree_lookups += state.degree_lookups;
+
+  return !state.gave_up;
+}
+
+/******************************************************************************
+* solve_for_one_switch_memo
+* The same search as solve_for_one_switch, with the same arguments and the
+* same answer, except that it remembers things.
+*
+* solve_for_one_switch gets to the same switch over and over, down every
+* path that leads there, and works out everything below it every time. All
+* it remembers is best_so_far, so only the paths that have already thrown
+* too many get cut short.
+*
+* But how many flips it takes to get out from a switch only depends on how
+* Skippy got there in one way: whether the switch has to be thrown back to
+* the track he came in on. That's part of the track's step_cost, so it
+* gets added on the way in, and everything after it is the same no matter
+* which switch came before. So the first time the search gets to a switch,
+* it works out below[switch] (and best_track, the way to get it), and every
+* other time, it just adds the track's step_cost to what it remembered.
+* Every switch gets gone below once and every track gets looked at twice
+* (once on the way down, once to pick the best), so it's as much work as
+* the yard is big, instead of as much as it has paths.
+*
+* It doesn't give up on paths that throw too many (there's no best_so_far
+* yet while it's going down): a number that got cut short couldn't be
+* remembered.
+*
+* Ties: best_track is the first of a switch's tracks (the lowest numbered
+* switch) that gets out in the fewest flips, and the path is read off of
+* best_track from the start. That's the same path solve_for_one_switch
+* keeps, since it tries the tracks in that order and only keeps a path that
+* is strictly better.
+******************************************************************************/
+
+void solve_for_one_switch_memo(const track_graph &graph,
+							   int starting_switch,
+							   int &best_so_far,
+							   vector<int> &best_answer)
+{
+  memo_state state;
+  search_stats &stats = graph.stats;
+
+  state.below.assign(graph.switches_used + 1, NOT_REMEMBERED);
+  state.best_track.assign(graph.switches_used + 1, NO_SIDETRACK);
+
+  memo_frame frame;
+
+  frame.current_switch = starting_switch;
+  frame.next_track = graph.out_start[starting_switch];
+
+  state.answer.push_back(frame);
+  state.below[starting_switch] = LARGE_NUMBER;
+  stats.arrivals++;
+
+  /**************************************************************************
+   * Go down every track of the switch on top of the path we haven't been
+   * below yet. Once they all have been, the switch is done too.
+   *
+   * A switch on the path is LARGE_NUMBER in below until it's done, so if
+   * the yard has a loop in it (it shouldn't), the search doesn't go around
+   * it forever, it just never finds a way out that way.
+   **************************************************************************/
+
+  while(!state.answer.empty())
+  {
+    memo_frame &top = state.answer.back();
+
+    if(top.next_track == graph.out_start[top.current_switch + 1])
+    {
+      finish_memo_switch(graph, state, top.current_switch);
+      state.answer.pop_back();
+      continue;
+    }
+
+    int to = track_to(graph.out_track[top.next_track++]);
+
+    if(state.below[to] != NOT_REMEMBERED)
+    {
+      stats.prunes++;
+      continue;
+    }
+
+    frame.current_switch = to;
+    frame.next_track = graph.out_start[to];
+
+    state.answer.push_back(frame);
+    state.below[to] = LARGE_NUMBER;
+    stats.arrivals++;
+
+    if((int)state.answer.size() > stats.max_depth)
+      stats.max_depth = state.answer.size();
+  }
+
+  /**************************************************************************
+   * Now the best path is just following best_track down from the start.
+   **************************************************************************/
+
+  int current_switch = starting_switch;
+
+  best_so_far = state.below[starting_switch];
+  best_answer.clear();
+  best_answer.push_back(current_switch);
+
+  while(state.best_track[current_switch] != NO_SIDETRACK)
+  {
+    current_switch =
+      track_to(graph.out_track[state.best_track[current_switch]]);
+    best_answer.push_back(current_switch);
+  }
+
+  stats.improvements++;
+}
+
+/******************************************************************************
+* finish_memo_switch
+* Every track out of current_switch has been gone down, so work out
+* below and best_track for it: nothing for an exit, otherwise the best of
+* its tracks, the first one on a tie.
+******************************************************************************/
+
+void finish_memo_switch(const track_graph &graph, memo_state &state,
+						int current_switch)
+{
+  int best = (connects_to_x(graph, current_switch,
+                            graph.degree_lookups) == 0) ? NOTHING_DONE
+                                                        : LARGE_NUMBER;
+
+  for(int track = graph.out_start[current_switch];
+      track < graph.out_start[current_switch + 1]; track++)
+  {
+    int cost = step_cost(graph.out_track[track]) +
+               state.below[track_to(graph.out_track[track])];
+
+    if(cost < best)
+    {
+      best = cost;
+      state.best_track[current_switch] = track;
+    }
+  }
+
+  state.below[current_switch] = best;
+}
+
+/******************************************************************************
+* continue_search
+* Keeps going with a search until there's nothing left on its path.
+******************************************************************************/
+
+void continue_search(const track_graph &graph, search_state &state)
+{
+  vector<search_frame> &answer = state.answer;
+
+  /**************************************************************************
+   * Well, we didn't find the exit yet :(
+   * So, let's continue from the switch on top of our path. We are going to
+   * try every connection possible and see if it is the overall best answer.
+   * This can be seen as a DFS (depth first search) or best visualized as
+   * having a rope and inserting it into a plumbing system. The rop can go
+   * down a whole bunch of paths but only one at a time. Instead of pulling
+   * it all the way out of the pipes, you try to move the ope into every pipe
+   * that the current pipe you are in connects to. Once we've tried every
+   * pipe from here, we pull the rope back one pipe.
+   *
+   * Every track leaving this switch is one of 2 kinds:
+   *
+   * Not the default: We can get there, but we must increment the current_val
+   * because we have to throw a switch to use this track (unless it's the
+   * only track, then there's nothing to throw).
+   *
+   * The default: This means we can get to the next switch using a track
+   * without throwing the switch we are at right now. So we just move on to
+   * the next switch.
+   *
+   * Tracks coming into a switch are taken care of in arrive_at_switch.
+   **************************************************************************/
+
+  while(!answer.empty())
+  {
+    search_frame &top = answer.back();
+
+    if(top.next_track == graph.out_start[top.current_switch + 1])
+    {
+      answer.pop_back();
+      continue;
+    }
+
+    int track = graph.out_track[top.next_track++];
+    int current_switch = top.current_switch;
+    int current_val = top.current_val;
+
+    if( (connects_to_x(graph, current_switch, state.degree_lookups) > 1) &&
+        !track_is_default(track) )
+      current_val++;
+
+    arrive_at_switch(graph, state, current_val, track_to(track),
+                     current_switch);
+  }
+}
+
+/******************************************************************************
+* arrive_at_switch
+* This is what solve_for_one_switch does every time Skippy rolls onto a
+* switch. It returns true if the switch was added to the path to be tried.
+*
+* state:          The search we are part of.
+*
+* current_val:    The number of switches we've thrown so far to get here.
+*
+* current_switch: Which switch we are at right now.
+*
+* last_switch:    The last switch that we were at. This is needed for the
+*				  "backwards" to see if it is the default setting.
+******************************************************************************/
+
+bool arrive_at_switch(const track_graph &graph,
+					  search_state &state,
+					  int current_val,
+					  int current_switch,
+					  int last_switch)
+{
+  /**************************************************************************
+   * Easiest thing to do? If we are currently in a track position,
+   * such that we have flipped more (or an equal number of)
+   * switches then the "best" path would use, there is really no reason
+   * to solve the answer from this switch to the exit, as it CAN'T be better
+   * than anything previously computed.
+   *
+   * Essentially, if we flipped a bunch of switches, and the
+   * best answer so far flipped less switches, it doesn't matter
+   * where we go from here. We cannot find a better answer, so just
+   * give up!
+   *
+   * Before we can determine that, we must look at how we got to the current
+   * switch. If it's a switch with a bunch of tracks coming to it and
+   * one path exiting, then we need to make sure that switch is set.
+   * We count how many tracks are leaving the current switch.
+   * If the number is 0, we are at the exit. If the number is 1, a whole
+   * bunch came together and, after this, we are going forward to one 
+   * specific switch.  In either case, we just look "backwards" to see if 
+   * the switch is ok!
+   **************************************************************************/
+
+  int howmany = connects_to_x(graph, current_switch, state.degree_lookups);
+
+  current_val += backward_cost(graph, current_switch, last_switch,
+                               state.degree_lookups);
+  state.stats.arrivals++;
+
+  if((int)state.answer.size() + 1 > state.stats.max_depth)
+    state.stats.max_depth = state.answer.size() + 1;
+
+  /**************************************************************************
+   * If we've been at this too long, stop. Throwing away the whole path
+   * leaves continue_search with nothing left to try.
+   **************************************************************************/
+
+  if( (state.budget > 0) && (state.stats.arrivals > state.budget) )
+  {
+    state.gave_up = true;
+    state.answer.clear();
+    return false;
+  }
+
+  /**************************************************************************
+   * Here's the "give up if the current answer is worse" line.
+   * This line will drastically increase timing on big test cases. If your
+   * team got a lot of "Time-Limit Exceeded" responses, This is probably why!
+   * If you don't believe me, remove it and run this program :)
+   *
+   * There are much better ways to speed this program up, but this is the
+   * easiest approach and the judge data will not test for any other kind of
+   * optimizations.
+   **************************************************************************/
+
+  if(current_val >= state.best_so_far)
+  {
+    state.stats.prunes++;
+    return false;
+  }
+
+  /**************************************************************************
+   * If other threads are searching other parts of the yard, we can also
+   * give up once one of them has done better. Doing "as well" only counts
+   * if it was in a part of the yard that comes earlier in the order we try
+   * tracks, because otherwise we still might find the same number of flips
+   * on a path that gets printed ahead of theirs.
+   **************************************************************************/
+
+  if( (state.incumbent != NULL) &&
+      ((((long long)current_val) << TASK_BITS) + state.task >=
+       state.incumbent->load(memory_order_relaxed)) )
+  {
+    state.stats.prunes++;
+    return false;
+  }
+
+  /**************************************************************************
+   * Ok, if we get here, then we might be looking at a better solution.
+   * So now check to see, did we exit the system?
+   * If we exited then... current_switch won't have any tracks leaving it.
+   *
+   * If it is the best solution, we need to copy the current path
+   * into our "best" path (well, the part of it that changed). We also need
+   * to set the number of switches thrown in the best path to the current
+   * value. Once we do this, we don't need to try and connect to any more
+   * switches.
+   **************************************************************************/
+
+  if(howmany == 0)
+  {
+    update_best_answer(state, current_switch);
+
+    state.best_so_far = current_val;
+    state.stats.improvements++;
+
+    if(state.incumbent != NULL)
+    {
+      long long found = (((long long)current_val) << TASK_BITS) + state.task;
+      long long known = state.incumbent->load();
+
+      while( (found < known) &&
+             !state.incumbent->compare_exchange_weak(known, found) )
+        ;
+    }
+
+    return false;
+  }
+
+  /**************************************************************************
+   * Otherwise, store where we are now in our answer so the search can try
+   * its tracks.
+   *
+   * Everything below the new frame hasn't changed since the last time we
+   * were at this depth, so best_shared only has to be cut down to here. If
+   * the best path goes through this same switch next, one more is shared.
+   **************************************************************************/
+
+  int depth = state.answer.size();
+
+  if(state.best_shared > depth)
+    state.best_shared = depth;
+
+  if( (state.best_shared == depth) &&
+      (depth < (int)state.best_answer.size()) &&
+      (state.best_answer[depth] == current_switch) )
+    state.best_shared++;
+
+  search_frame frame;
+
+  frame.current_switch = current_switch;
+  frame.current_val = current_val;
+  frame.next_track = graph.out_start[current_switch];
+
+  state.answer.push_back(frame);
+
+  return true;
+}
+
+/******************************************************************************
+* backward_cost
+* Rolling onto a switch with one (or zero) tracks leaving it costs a flip if
+* that switch isn't set back to the track we came in on. At the very start
+* (last_switch is NOTHING_DONE) we didn't come in on any track, so it's free.
+******************************************************************************/
+
+int backward_cost(const track_graph &graph,
+				  int current_switch,
+				  int last_switch,
+				  long long &lookups)
+{
+  if( (connects_to_x(graph, current_switch, lookups) <= 1) &&
+      (last_switch != NOTHING_DONE) &&
+      (graph.default_setting[current_switch] != last_switch) )
+    return 1;
+
+  return NOTHING_DONE;
+}
+
+/******************************************************************************
+* solve_for_one_switch_threaded
+* The same search as solve_for_one_switch, split between threads. It finds
+* the same route, not just one with the same number of flips.
+*
+* First split_search cuts the yard into tasks: the paths down to some
+* switches near the top, in the same order the search would have tried them
+* in. Each thread takes the next task that hasn't been started yet and
+* searches everything below it, the same way solve_for_one_switch would.
+*
+* The threads share one number, the incumbent: the fewest flips found so
+* far, together with which task found them. A thread gives up on a path
+* once it can't beat that (see arrive_at_switch). Since ties go to whichever
+* task comes first, the winner is the earliest task with the fewest flips,
+* and inside it the first path the search finds - exactly the one a single
+* thread would have kept.
+*
+* The budget (see solve_for_one_switch) is split evenly between the
+* threads. Once any of them runs out, they all stop and it returns false.
+******************************************************************************/
+
+bool solve_for_one_switch_threaded(const track_graph &graph,
+								   int starting_switch,
+								   int &best_so_far,
+								   vector<int> &best_answer,
+								   int threads,
+								   long long budget)
+{
+  vector<search_task> tasks;
+
+  split_search(graph, starting_switch, tasks, threads * TASKS_PER_THREAD);
+
+  int total_tasks = tasks.size();
+
+  vector<int> task_best(total_tasks, LARGE_NUMBER);
+  vector< vector<int> > task_answer(total_tasks);
+
+  atomic<long long> incumbent(((long long)LARGE_NUMBER) << TASK_BITS);
+  atomic<int> next_task(0);
+  atomic<bool> gave_up(false);
+  vector<thread> workers;
+  vector<search_stats> worker_stats(threads);
+  vector<long long> worker_lookups(threads);
+
+  for(int worker = 0; worker < threads; worker++)
+  {
+    workers.push_back(thread([&, worker]()
+    {
+      search_state state;
+      int index;
+
+      state.incumbent = &incumbent;
+      state.budget = (budget > 0) ? max(budget / threads, 1LL) : 0;
+      state.gave_up = false;
+      state.degree_lookups = 0;
+      clear_stats(state.stats);
+
+      while(!gave_up && ((index = next_task++) < total_tasks))
+      {
+        state.best_so_far = best_so_far;
+        state.best_answer.clear();
+        state.best_shared = 0;
+        state.task = index;
+
+        run_search_task(graph, tasks[index], state);
+
+        task_best[index] = state.best_so_far;
+        task_answer[index].swap(state.best_answer);
+
+        if(state.gave_up)
+          gave_up = true;
+      }
+
+      worker_stats[worker] = state.stats;
+      worker_lookups[worker] = state.degree_lookups;
+    }));
+  }
+
+  for(int worker = 0; worker < threads; worker++)
+  {
+    workers[worker].join();
+    add_stats(graph.stats, worker_stats[worker]);
+    graph.degree_lookups += worker_lookups[worker];
+  }
+
+  /**************************************************************************
+   * The first task with the fewest flips wins.
+   **************************************************************************/
+
+  for(int index = 0; index < total_tasks; index++)
+  {
+    if(task_best[index] < best_so_far)
+    {
+      best_so_far = task_best[index];
+      best_answer.swap(task_answer[index]);
+    }
+  }
+
+  return !gave_up;
+}
+
+/******************************************************************************
+* split_search
+* Cuts the search from starting_switch into at least "wanted" tasks (if the
+* yard is big enough), in the order the search would have tried them.
+*
+* We start with one task, the whole yard, and keep replacing every task by
+* one task for each track leaving its switch until there are enough of them.
+* Tasks that are already at an exit can't be cut, so they stay as they are.
+* Switches with one track don't add tasks, so SPLIT_DEPTH stops us from
+* walking all the way down a long chain.
+******************************************************************************/
+
+void split_search(const track_graph &graph,
+				  int starting_switch,
+				  vector<search_task> &tasks,
+				  int wanted)
+{
+  search_task first;
+
+  first.current_switch = starting_switch;
+  first.last_switch = NOTHING_DONE;
+  first.current_val = NOTHING_DONE;
+
+  tasks.clear();
+  tasks.push_back(first);
+
+  for(int depth = 0; (depth < SPLIT_DEPTH) && ((int)tasks.size() < wanted);
+      depth++)
+  {
+    vector<search_task> cut;
+    bool any_cut = false;
+
+    for(int index = 0; index < (int)tasks.size(); index++)
+    {
+      const search_task &task = tasks[index];
+      int current_switch = task.current_switch;
+      int howmany = connects_to_x(graph, current_switch, graph.degree_lookups);
+
+      if(howmany == 0)
+      {
+        cut.push_back(task);
+        continue;
+      }
+
+      int current_val = task.current_val +
+                        backward_cost(graph, current_switch, task.last_switch,
+                                      graph.degree_lookups);
+
+      for(int track = graph.out_start[current_switch];
+          track < graph.out_start[current_switch + 1]; track++)
+      {
+        search_task next;
+
+        next.prefix = task.prefix;
+        next.prefix.push_back(current_switch);
+        next.current_switch = track_to(graph.out_track[track]);
+        next.last_switch = current_switch;
+        next.current_val = current_val;
+
+        if( (howmany > 1) && !track_is_default(graph.out_track[track]) )
+          next.current_val++;
+
+        cut.push_back(next);
+      }
+
+      any_cut = true;
+    }
+
+    tasks.swap(cut);
+
+    if(!any_cut)
+      break;
+  }
+}
+
+/******************************************************************************
+* run_search_task
+* Searches everything below one task. The switches above it go on the path
+* first, with all of their tracks marked as tried, so the search ends as
+* soon as it backs up out of the task.
+******************************************************************************/
+
+void run_search_task(const track_graph &graph,
+					 const search_task &task,
+					 search_state &state)
+{
+  state.answer.clear();
+
+  for(int index = 0; index < (int)task.prefix.size(); index++)
+  {
+    search_frame frame;
+
+    frame.current_switch = task.prefix[index];
+    frame.current_val = NOTHING_DONE;
+    frame.next_track = graph.out_start[task.prefix[index] + 1];
+
+    state.answer.push_back(frame);
+  }
+
+  arrive_at_switch(graph, state, task.current_val, task.current_switch,
+                   task.last_switch);
+
+  continue_search(graph, state);
+}
+
+/******************************************************************************
+* connects_to_x
+* This function takes the track graph and which switch we are at.
+* It returns how many exits the switch has as an integer, and counts the
+* look up in lookups (graph.degree_lookups, or a search's own count).
+******************************************************************************/
+
+int connects_to_x(const track_graph &graph, const int &switch_num,
+				  long long &lookups)
+{
+  lookups++;
+
+  return graph.out_degree[switch_num];
+}
+
+/******************************************************************************
+* solve_by_dp
+* This gets the same answer as solve_for_one_switch, but without trying every
+* path from the starting switch. On big yards with lots of branches the number
+* of paths grows exponentially, and the pruning in solve_for_one_switch can
+* only do so much about that.
+*
+* graph:            How the tracks connect switches.
+*
+* starting_switch:  Where Skippy is.
+*
+* best_so_far:      Gets the lowest number of switches thrown.
+*
+* best_answer:      Gets the path.
+*
+* The trick is that once Skippy gets to a switch, the number of flips needed
+* to get from there to the exit doesn't depend on how he got there. The only
+* thing that depends on the previous switch is whether we had to throw the
+* switch we just rolled onto (the "backward" check), and that belongs to the
+* track we came in on. So every track from A to B gets a cost of 0 or 1
+* (step_cost), and each switch gets one number: exit_cost[A], the fewest
+* flips from A to the exit.
+*
+* Because the tracks all go downhill, we can order the switches so that every
+* track goes from an earlier switch to a later one (a topological order).
+* Walking that order backwards, everything a switch connects to has already
+* been solved, so exit_cost[A] is just the smallest step_cost + exit_cost
+* over its tracks. That's one look at every track instead of one look at
+* every path.
+*
+* Ties: solve_for_one_switch tries the tracks in order of switch number and
+* only keeps a path if it is strictly better, so out of all of the best paths
+* it keeps the one that comes first when comparing switch by switch. We get
+* the same one by walking forward from the start and always taking the lowest
+* numbered switch that still stays on a best path.
+******************************************************************************/
+
+void solve_by_dp(const track_graph &graph,
+				 int starting_switch,
+				 int &best_so_far,
+				 vector<int> &best_answer)
+{
+  vector<int> order;
+  vector<int> in_degree;
+  vector<int> exit_cost;
+
+  solve_all_starts(graph, order, in_degree, exit_cost);
+
+  walk_best_path(graph, starting_switch, exit_cost, best_so_far,
+                 best_answer);
+}
+
+/******************************************************************************
+* solve_all_starts
+* The part of solve_by_dp that doesn't care where Skippy is: put the
+* switches in order, then solve every one of them from the bottom of the
+* hill up. Afterwards exit_cost[A] is the fewest flips from A to the exit,
+* for every switch A at once, so asking about any start is just a look up.
+*
+* order and in_degree are just working space, kept by the caller so it
+* can reuse them. If the yard came with its order already worked out
+* (by check_yard, or from a compiled file), that's just copied into order.
+******************************************************************************/
+
+void solve_all_starts(const track_graph &graph,
+					  vector<int> &order,
+					  vector<int> &in_degree,
+					  vector<int> &exit_cost)
+{
+  if(graph.order.empty())
+    topological_order(graph, order, in_degree);
+  else
+    order = graph.order;
+
+  exit_cost.assign(graph.switches_used + 1, LARGE_NUMBER);
+
+  for(int index = order.size() - 1; index >= 0; index--)
+    exit_cost[order[index]] = switch_exit_cost(graph, order[index],
+                                               exit_cost);
+}
+
+/******************************************************************************
+* topological_order
+* Puts the switches in order so that every track goes from an earlier switch
+* to a later one. If the yard has a loop in it (it shouldn't), the switches
+* on or below the loop are left out. in_degree is just somewhere to count
+* in, so a caller that solves over and over can keep reusing it.
+******************************************************************************/
+
+void topological_order(const track_graph &graph, vector<int> &order,
+					   vector<int> &in_degree)
+{
+  in_degree = graph.in_degree;
+
+  /**************************************************************************
+   * A switch with nothing coming into it can go first in the order. The
+   * degree index already has those, and how many tracks come into the rest.
+   **************************************************************************/
+
+  order = graph.sources;
+
+  int order_size = order.size();
+
+  order.resize(graph.switches_used);
+
+  /**************************************************************************
+   * Take switches off the front of the order, and once every track into a
+   * switch has been used up, it can join the order too.
+   **************************************************************************/
+
+  for(int index = 0; index < order_size; index++)
+  {
+    int from = order[index];
+
+    graph.stats.arrivals++;
+
+    for(int track = graph.out_start[from];
+        track < graph.out_start[from + 1]; track++)
+    {
+      int to = track_to(graph.out_track[track]);
+
+      in_degree[to]--;
+
+      if(in_degree[to] == 0)
+        order[order_size++] = to;
+    }
+  }
+
+  order.resize(order_size);
+}
+
+/******************************************************************************
+* check_yard
+* Makes sure graph is a yard Skippy can get out of before anything tries to
+* solve it. The input is supposed to be fine, but the solvers trust that,
+* and a yard that isn't can send them around a loop forever. Returns false,
+* with what's wrong in problem, if:
+*
+*		every switch has a track coming into it, so there's nowhere for
+*		Skippy to start,
+*		the tracks go around in a loop, so the switches can't be put in
+*		topological order (see solve_by_dp), or
+*		a switch is set to a switch it has no track to or from.
+*
+* There's no need to check that the exit can be reached from the start:
+* once there aren't any loops, every way down the hill has to end at a
+* switch with no tracks leaving it, and that's an exit.
+*
+* The order it works out goes in graph.order, so solve_all_starts doesn't
+* have to do it again. A yard from a compiled file already has its order
+* (check_yard went over it when it was compiled), so that isn't done
+* twice either. in_degree is working space for topological_order.
+*
+* Everything here looks at each switch and track once or twice, so it's
+* about as much work as solve_by_dp.
+******************************************************************************/
+
+bool check_yard(track_graph &graph, vector<int> &in_degree, string &problem)
+{
+  problem.clear();
+
+  if(graph.sources.empty())
+  {
+    problem = "every switch has a track coming into it, so there's nowhere"
+              " to start";
+    return false;
+  }
+
+  if((int)graph.order.size() != graph.switches_used)
+    topological_order(graph, graph.order, in_degree);
+
+  if((int)graph.order.size() != graph.switches_used)
+  {
+    ostringstream out;
+
+    out << "switch " << find_loop(graph, in_degree) << " is on a loop";
+    problem = out.str();
+    graph.order.clear();
+    return false;
+  }
+
+  /**************************************************************************
+   * A switch with no tracks at all (a yard with only one switch) is
+   * already out, so it doesn't matter what it's set to.
+   **************************************************************************/
+
+  for(int sw = 1; sw <= graph.switches_used; sw++)
+  {
+    if( (graph.out_degree[sw] == 0) && (graph.in_degree[sw] == 0) )
+      continue;
+
+    if(!has_neighbor(graph, sw, graph.default_setting[sw]))
+    {
+      ostringstream out;
+
+      out << "switch " << sw << " is set to " << graph.default_setting[sw]
+          << ", but it has no track to or from it";
+      problem = out.str();
+      return false;
+    }
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* find_loop
+* Once topological_order has left some switches out, finds one that's on
+* a loop (not just below one) to tell people about.
+*
+* in_degree is what topological_order left behind: how many tracks into
+* each switch weren't used up. That's more than 0 exactly for the switches
+* it left out, and every one of those has one of them right above it. So
+* start at any of them and keep going up to one of those, and sooner or
+* later we get back to a switch we've already been to. in_degree gets
+* turned negative for the switches we've been to, which is why it's
+* changed when we're done.
+******************************************************************************/
+
+int find_loop(const track_graph &graph, vector<int> &in_degree)
+{
+  int sw = 1;
+
+  while(in_degree[sw] == 0)
+    sw++;
+
+  while(in_degree[sw] > 0)
+  {
+    in_degree[sw] = -in_degree[sw];
+
+    int track = graph.in_start[sw];
+
+    while(in_degree[graph.in_track[track]] == 0)
+      track++;
+
+    sw = graph.in_track[track];
+  }
+
+  return sw;
+}
+
+/******************************************************************************
+* has_neighbor
+* Whether switch_num has a track down to neighbor, or one coming into it
+* from neighbor.
+******************************************************************************/
+
+bool has_neighbor(const track_graph &graph, int switch_num, int neighbor)
+{
+  for(int track = graph.out_start[switch_num];
+      track < graph.out_start[switch_num + 1]; track++)
+    if(track_to(graph.out_track[track]) == neighbor)
+      return true;
+
+  for(int track = graph.in_start[switch_num];
+      track < graph.in_start[switch_num + 1]; track++)
+    if(graph.in_track[track] == neighbor)
+      return true;
+
+  return false;
+}
+
+/******************************************************************************
+* switch_exit_cost
+* The fewest flips from switch "from" to the exit, given exit_cost for
+* every switch its tracks go to. Exits are free.
+******************************************************************************/
+
+int switch_exit_cost(const track_graph &graph, int from,
+					 const vector<int> &exit_cost)
+{
+  int best = LARGE_NUMBER;
+
+  if(connects_to_x(graph, from, graph.degree_lookups) == 0)
+    return NOTHING_DONE;
+
+  for(int track = graph.out_start[from];
+      track < graph.out_start[from + 1]; track++)
+  {
+    int cost = step_cost(graph.out_track[track]) +
+               exit_cost[track_to(graph.out_track[track])];
+
+    if(cost < best)
+      best = cost;
+  }
+
+  return best;
+}
+
+/******************************************************************************
+* walk_best_path
+* Once exit_cost is filled in, walks the best path from the start, taking
+* the lowest numbered switch whenever there's a tie.
+******************************************************************************/
+
+void walk_best_path(const track_graph &graph,
+					int starting_switch,
+					const vector<int> &exit_cost,
+					int &best_so_far,
+					vector<int> &best_answer)
+{
+  best_so_far = exit_cost[starting_switch];
+
+  int current_switch = starting_switch;
+
+  best_answer.clear();
+  best_answer.push_back(current_switch);
+
+  while(connects_to_x(graph, current_switch, graph.degree_lookups) != 0)
+  {
+    for(int track = graph.out_start[current_switch];
+        track < graph.out_start[current_switch + 1]; track++)
+    {
+      int to = track_to(graph.out_track[track]);
+
+      if(step_cost(graph.out_track[track]) +
+         exit_cost[to] == exit_cost[current_switch])
+      {
+        current_switch = to;
+        break;
+      }
+    }
+
+    best_answer.push_back(current_switch);
+  }
+
+  if((int)best_answer.size() > graph.stats.max_depth)
+    graph.stats.max_depth = best_answer.size();
+}
+
+/******************************************************************************
+* solve_small_yard
+* Gets the same answer as solve_by_dp (and checks the yard the way
+* check_yard does) for a yard with up to SMALL_YARD_LARGEST switches.
+* Returns false, without changing best_so_far or best_answer, if the yard
+* is too big, isn't numbered downhill, or something is wrong with it.
+*
+* Most yards are like the ones in cymbal.in: a handful of switches, and
+* whoever drew them numbered them going down the hill, so every track goes
+* from a switch to one with a bigger number. When that's true, the order
+* check_yard and solve_by_dp work out is just 1, 2, 3..., and there can't
+* be a loop, so there's nothing to sort. That's most of the work for a
+* small yard, since it's all loops where the computer has to guess whether
+* it goes around again.
+*
+* So each switch's exit cost is the cheapest of its tracks, from the
+* bottom of the hill up, and the path is walked off of the cheapest tracks,
+* exactly like solve_by_dp, so it gets the same route. That's the only time
+* the tracks get gone through, so the other thing check_yard does (making
+* sure every switch is set to a switch it has a track to or from) is
+* worked out on the way past too, in set_right. None of it needs more than
+* SMALL_YARD_LARGEST of anything, so it all goes on the stack.
+*
+* A yard that isn't numbered downhill (or that has anything wrong with it)
+* is left for check_yard and solve_by_dp.
+******************************************************************************/
+
+bool solve_small_yard(const track_graph &graph,
+					  int starting_switch,
+					  int &best_so_far,
+					  vector<int> &best_answer)
+{
+  const int switches_used = graph.switches_used;
+  const int *out_start = &graph.out_start[0];
+  const int *out_track = &graph.out_track[0];
+  const int *setting = &graph.default_setting[0];
+
+  int below[SMALL_YARD_LARGEST + 1];
+  int best_to[SMALL_YARD_LARGEST + 1];
+  int set_right[SMALL_YARD_LARGEST + 1];
+
+  if(switches_used > SMALL_YARD_LARGEST)
+    return false;
+
+  /**************************************************************************
+   * Solve them from the bottom of the hill up (step_cost already knows
+   * what each track costs), and make sure every track goes downhill and
+   * every switch is set to a real one. A track that doesn't is counted as
+   * going to switch 0, which is never used, so the loop doesn't have to
+   * stop for it before the whole yard gets thrown out.
+   *
+   * A track from sw to "to" is what sw is set to if it looks forward, and
+   * what "to" is set to if it looks backward. Nothing above sw has been
+   * looked at yet, so nothing has touched its set_right before this.
+   **************************************************************************/
+
+  int uphill = 0;
+
+  below[0] = NOTHING_DONE;
+  set_right[0] = 0;
+
+  for(int sw = switches_used; sw >= 1; sw--)
+  {
+    int best = (out_start[sw + 1] == out_start[sw]) ? NOTHING_DONE :
+                                                      LARGE_NUMBER;
+    int best_track = NO_SIDETRACK;
+
+    uphill |= ((unsigned)(setting[sw] - 1) >= (unsigned)switches_used);
+    set_right[sw] = 0;
+
+    for(int track = out_start[sw]; track < out_start[sw + 1]; track++)
+    {
+      int to = track_to(out_track[track]);
+      int downhill = (to > sw) & (to <= switches_used);
+
+      uphill |= !downhill;
+      to = downhill ? to : 0;
+
+      set_right[sw] |= (setting[sw] == to);
+      set_right[to] |= (setting[to] == sw);
+
+      int cost = step_cost(out_track[track]) + below[to];
+
+      best_track = (cost < best) ? track : best_track;
+      best = min(cost, best);
+    }
+
+    below[sw] = best;
+    best_to[sw] = best_track;
+  }
+
+  if(uphill)
+    return false;
+
+  /**************************************************************************
+   * Every switch with any tracks at all has to be set to one of them.
+   **************************************************************************/
+
+  int broken = 0;
+
+  for(int sw = 1; sw <= switches_used; sw++)
+    broken |= ((out_start[sw + 1] != out_start[sw]) |
+               (graph.in_degree[sw] != 0)) & !set_right[sw];
+
+  if(broken)
+    return false;
+
+  /**************************************************************************
+   * Now the path is just following best_to down from Skippy.
+   **************************************************************************/
+
+  int current_switch = starting_switch;
+
+  best_so_far = below[current_switch];
+  best_answer.clear();
+  best_answer.push_back(current_switch);
+
+  while(best_to[current_switch] != NO_SIDETRACK)
+  {
+    current_switch = track_to(out_track[best_to[current_switch]]);
+    best_answer.push_back(current_switch);
+  }
+
+  graph.stats.arrivals += switches_used;
+  graph.stats.improvements++;
+
+  if((int)best_answer.size() > graph.stats.max_depth)
+    graph.stats.max_depth = best_answer.size();
+
+  return true;
+}
+
+/******************************************************************************
+* find_best_routes
+* Once exit_cost is filled in, finds the most_routes routes from
+* starting_switch that throw the fewest switches, best first, and puts them
+* in routes. With ties_only, it stops at the last one that throws as few as
+* the best. The first is always the route walk_best_path takes, and no two
+* are the same.
+*
+* Running the search again for every route would be slow, and taking out
+* a track to find the next best route (like people do for roads) is
+* slower still. Instead, every route is the best route with some
+* sidetracks taken (see sidetrack), and it throws
+*
+*		exit_cost[starting_switch] + the deltas of its sidetracks
+*
+* switches. After a sidetrack to switch B, the cart is on B's best route,
+* so the next sidetrack is one of the ones in B's heap. That means the
+* routes can be lined up in a tree: a route's next routes are
+*
+*		the same route with one more sidetrack, the top of B's heap, or
+*		the same route with its last sidetrack swapped for one of the two
+*		under it in the heap it came from,
+*
+* none of which throw fewer switches than it does. So taking the route
+* with the fewest flips out of the ones waiting, and putting its (at most
+* three) next routes in, finds them in order. This is Eppstein's way of
+* finding the k shortest paths, made simpler by not having any loops.
+*
+* Everything is made fresh for each call, so this is for printing, not for
+* asking over and over.
+******************************************************************************/
+
+void find_best_routes(const track_graph &graph,
+					  int starting_switch,
+					  const vector<int> &exit_cost,
+					  int most_routes,
+					  bool ties_only,
+					  route_list &routes)
+{
+  route_search search;
+
+  routes.flips.clear();
+  routes.start.assign(1, 0);
+  routes.switches.clear();
+
+  if( (most_routes < 1) || (exit_cost[starting_switch] >= LARGE_NUMBER) )
+    return;
+
+  search.heap.assign(graph.switches_used + 1, NO_SIDETRACK);
+  search.built.assign(graph.switches_used + 1, false);
+  search.best_track.assign(graph.switches_used + 1, NO_SIDETRACK);
+
+  int best = exit_cost[starting_switch];
+  int first = sidetrack_heap(search, graph, exit_cost, starting_switch);
+
+  add_found_route(search, graph, starting_switch, NO_SIDETRACK, best,
+                  routes);
+
+  route_candidate candidate;
+
+  candidate.node = first;
+  candidate.before = NO_SIDETRACK;
+
+  if(first != NO_SIDETRACK)
+  {
+    search.candidates.push_back(candidate);
+    search.waiting.push(((long long)(best + search.sidetracks[first].delta)
+                         << TASK_BITS) + 0);
+  }
+
+  while( !search.waiting.empty() &&
+         ((int)routes.flips.size() < most_routes) )
+  {
+    long long next = search.waiting.top();
+    int flips = next >> TASK_BITS;
+
+    search.waiting.pop();
+
+    if(ties_only && (flips > best))
+      break;
+
+    candidate = search.candidates[next & ((1LL << TASK_BITS) - 1)];
+
+    /************************************************************************
+     * It's a route we haven't had yet: the one it comes after, with this
+     * sidetrack taken.
+     ************************************************************************/
+
+    sidetrack taking = search.sidetracks[candidate.node];
+    route_taken taken;
+
+    taken.from = taking.from;
+    taken.track = taking.track;
+    taken.before = candidate.before;
+    search.taken.push_back(taken);
+
+    int taken_index = search.taken.size() - 1;
+    int to = track_to(graph.out_track[taking.track]);
+    int after = sidetrack_heap(search, graph, exit_cost, to);
+
+    add_found_route(search, graph, starting_switch, taken_index, flips,
+                    routes);
+
+    /************************************************************************
+     * And the (up to three) routes that come next after it.
+     ************************************************************************/
+
+    int next_node[3] = { taking.left, taking.right, after };
+    int next_before[3] = { candidate.before, candidate.before, taken_index };
+    int next_flips[3] = { flips - taking.delta, flips - taking.delta, flips };
+
+    for(int which = 0; which < 3; which++)
+    {
+      if(next_node[which] == NO_SIDETRACK)
+        continue;
+
+      candidate.node = next_node[which];
+      candidate.before = next_before[which];
+
+      search.waiting.push(((long long)(next_flips[which] +
+                           search.sidetracks[candidate.node].delta)
+                           << TASK_BITS) + search.candidates.size());
+      search.candidates.push_back(candidate);
+    }
+  }
+}
+
+/******************************************************************************
+* sidetrack_heap
+* Returns the heap of every sidetrack off of switch_num's best route,
+* working it out (and the heaps of the switches below it on that route)
+* if nobody has yet. A switch's heap is the heap of the switch its best
+* track goes to, with its own other tracks added.
+*
+* That's recursive, but a best route can be as long as the yard, so the
+* switches that still need a heap go on chain and get done from the
+* bottom up.
+******************************************************************************/
+
+int sidetrack_heap(route_search &search,
+				   const track_graph &graph,
+				   const vector<int> &exit_cost,
+				   int switch_num)
+{
+  int current_switch = switch_num;
+
+  search.chain.clear();
+
+  while(!search.built[current_switch])
+  {
+    search.chain.push_back(current_switch);
+
+    for(int track = graph.out_start[current_switch];
+        track < graph.out_start[current_switch + 1]; track++)
+    {
+      if(step_cost(graph.out_track[track]) +
+         exit_cost[track_to(graph.out_track[track])] ==
+         exit_cost[current_switch])
+      {
+        search.best_track[current_switch] = track;
+        break;
+      }
+    }
+
+    if(search.best_track[current_switch] == NO_SIDETRACK)
+      break;
+
+    current_switch =
+      track_to(graph.out_track[search.best_track[current_switch]]);
+  }
+
+  for(int index = search.chain.size() - 1; index >= 0; index--)
+  {
+    int from = search.chain[index];
+    int best_track = search.best_track[from];
+    int heap = NO_SIDETRACK;
+
+    graph.stats.arrivals++;
+
+    if(best_track != NO_SIDETRACK)
+      heap = search.heap[track_to(graph.out_track[best_track])];
+
+    for(int track = graph.out_start[from]; track < graph.out_start[from + 1];
+        track++)
+    {
+      int to = track_to(graph.out_track[track]);
+
+      if( (track == best_track) || (exit_cost[to] >= LARGE_NUMBER) )
+        continue;
+
+      heap = add_sidetrack(search, heap,
+                           step_cost(graph.out_track[track]) +
+                           exit_cost[to] - exit_cost[from], track, from);
+    }
+
+    search.heap[from] = heap;
+    search.built[from] = true;
+  }
+
+  return search.heap[switch_num];
+}
+
+/******************************************************************************
+* add_sidetrack
+* Returns heap with one more sidetrack in it. heap itself doesn't change.
+******************************************************************************/
+
+int add_sidetrack(route_search &search, int heap, int delta, int track,
+				  int from)
+{
+  sidetrack node;
+
+  node.delta = delta;
+  node.track = track;
+  node.from = from;
+  node.left = NO_SIDETRACK;
+  node.right = NO_SIDETRACK;
+  node.rank = 1;
+
+  search.sidetracks.push_back(node);
+
+  return merge_sidetracks(search, heap, search.sidetracks.size() - 1);
+}
+
+/******************************************************************************
+* merge_sidetracks
+* Returns a heap with everything in first and second in it, without
+* changing either of them: the nodes down the right side that would have
+* changed are copied instead. A leftist heap keeps its right side short
+* (the log of its size, at most), so that's only a few copies.
+*
+* Ties go to the lower track, so the same yard always gives the same
+* routes in the same order.
+******************************************************************************/
+
+int merge_sidetracks(route_search &search, int first, int second)
+{
+  if(first == NO_SIDETRACK)
+    return second;
+
+  if(second == NO_SIDETRACK)
+    return first;
+
+  const sidetrack &one = search.sidetracks[first];
+  const sidetrack &two = search.sidetracks[second];
+
+  if( (two.delta < one.delta) ||
+      ((two.delta == one.delta) && (two.track < one.track)) )
+    swap(first, second);
+
+  int copy = search.sidetracks.size();
+
+  search.sidetracks.push_back(search.sidetracks[first]);
+
+  int right = merge_sidetracks(search, search.sidetracks[copy].right,
+                               second);
+  sidetrack &node = search.sidetracks[copy];
+
+  node.right = right;
+
+  if(sidetrack_rank(search, node.left) < sidetrack_rank(search, node.right))
+    swap(node.left, node.right);
+
+  node.rank = sidetrack_rank(search, node.right) + 1;
+
+  return copy;
+}
+
+/******************************************************************************
+* sidetrack_rank
+* The rank of a heap node, counting an empty heap as 0.
+******************************************************************************/
+
+inline int sidetrack_rank(const route_search &search, int node)
+{
+  return (node == NO_SIDETRACK) ? NOTHING_DONE : search.sidetracks[node].rank;
+}
+
+/******************************************************************************
+* add_found_route
+* Adds the route that takes every sidetrack in the chain from taken back,
+* and the best tracks everywhere else, to the end of routes.
+******************************************************************************/
+
+void add_found_route(route_search &search,
+					 const track_graph &graph,
+					 int starting_switch,
+					 int taken,
+					 int flips,
+					 route_list &routes)
+{
+  search.path_taken.clear();
+
+  for(; taken != NO_SIDETRACK; taken = search.taken[taken].before)
+    search.path_taken.push_back(taken);
+
+  int current_switch = starting_switch;
+  int next = search.path_taken.size() - 1;
+
+  routes.switches.push_back(current_switch);
+
+  while(true)
+  {
+    int track = search.best_track[current_switch];
+
+    if( (next >= 0) &&
+        (search.taken[search.path_taken[next]].from == current_switch) )
+      track = search.taken[search.path_taken[next--]].track;
+
+    if(track == NO_SIDETRACK)
+      break;
+
+    current_switch = track_to(graph.out_track[track]);
+    routes.switches.push_back(current_switch);
+  }
+
+  routes.flips.push_back(flips);
+  routes.start.push_back(routes.switches.size());
+}
+
+/******************************************************************************
+* update_best_answer
+* The search just got to exit_switch down a better path than best_answer.
+* Make state.best_answer the switches in state.answer followed by
+* exit_switch.
+*
+* This used to copy the whole path (and then zero out the rest of the array)
+* every time, but when the best answer keeps getting better that's a lot of
+* copying of switches that didn't change. Usually the new path only turns off
+* of the old one somewhere near the bottom. arrive_at_switch keeps
+* best_shared up to date as the search goes, so everything before it is
+* already right and only the rest gets copied. Afterwards the whole stack is
+* shared.
+******************************************************************************/
+
+void update_best_answer(search_state &state, int exit_switch)
+{
+  int depth = state.answer.size();
+
+  if(state.best_shared > depth)
+    state.best_shared = depth;
+
+  state.best_answer.resize(depth + 1);
+
+  for(int i = state.best_shared; i < depth; i++)
+    state.best_answer[i] = state.answer[i].current_switch;
+
+  state.best_answer[depth] = exit_switch;
+
+  state.best_shared = depth;
+}
+
+/******************************************************************************
+* solve_yard
+* Solves yard.system from scratch, like solve_by_dp, but keeps the order and
+* exit_cost around so set_default and close_track can change the yard
+* later without starting over.
+******************************************************************************/
+
+void solve_yard(solved_yard &yard)
+{
+  track_system &system = yard.system;
+  const track_graph &graph = system.graph;
+
+  clear_stats(graph.stats);
+
+  solve_all_starts(graph, yard.order, yard.in_degree, yard.exit_cost);
+
+  yard.position.assign(graph.switches_used + 1, NOTHING_DONE);
+  yard.queued.assign(graph.switches_used + 1, false);
+
+  while(!yard.dirty.empty())
+    yard.dirty.pop();
+
+  for(int index = 0; index < (int)yard.order.size(); index++)
+    yard.position[yard.order[index]] = index;
+
+  system.starting_switch = get_starting(graph);
+  walk_best_path(graph, system.starting_switch, yard.exit_cost,
+                 system.lowest_switches, system.best_answer);
+}
+
+/******************************************************************************
+* set_default
+* Sets switch_num to new_default, like an operator throwing it for good.
+* Returns false (and changes nothing) if new_default isn't a switch that
+* switch_num has a track to or from, since check_yard would turn that yard
+* away (a switch with no tracks at all can be set to any switch).
+*
+* Only the costs of tracks out of switch_num (if it looks "forward") and
+* into it (if it looks "backward") can change, so switch_num and the
+* switches right above it are the only ones marked for resolve_yard.
+******************************************************************************/
+
+bool set_default(solved_yard &yard, int switch_num, int new_default)
+{
+  track_graph &graph = yard.system.graph;
+
+  if( (switch_num < 1) || (switch_num > graph.switches_used) ||
+      (new_default < 1) || (new_default > graph.switches_used) )
+    return false;
+
+  if( ((graph.out_degree[switch_num] != 0) ||
+       (graph.in_degree[switch_num] != 0)) &&
+      !has_neighbor(graph, switch_num, new_default) )
+    return false;
+
+  graph.default_setting[switch_num] = new_default;
+
+  for(int track = graph.out_start[switch_num];
+      track < graph.out_start[switch_num + 1]; track++)
+  {
+    graph.out_track[track] &= ~EDGE_DEFAULT;
+
+    if(track_to(graph.out_track[track]) == new_default)
+      graph.out_track[track] |= EDGE_DEFAULT;
+  }
+
+  mark_track_costs(graph, switch_num);
+  mark_with_feeders(yard, switch_num);
+
+  return true;
+}
+
+/******************************************************************************
+* close_track
+* Takes the track from "from" to "to" out of the yard. Returns false (and
+* changes nothing) if there isn't one, or if from is set to "to" or "to" is
+* set to from. Then the track is the one it's set to, and taking it out
+* would leave a yard check_yard turns away (like set_default won't). Throw
+* it somewhere else first.
+*
+* The track has to come out of the middle of out_track and in_track, which
+* moves everything after it down one spot. That's a memmove, not a re-solve:
+* the only costs that can change are from's own tracks (it has one less, and
+* might go from looking "forward" to "backward") and the tracks into from.
+* Taking a track away can't make the order wrong, but "to" might not have
+* anything coming into it any more, which makes it a source, and maybe the
+* new place Skippy starts.
+******************************************************************************/
+
+bool close_track(solved_yard &yard, int from, int to)
+{
+  track_graph &graph = yard.system.graph;
+
+  if( (from < 1) || (from > graph.switches_used) ||
+      (to < 1) || (to > graph.switches_used) )
+    return false;
+
+  int out_spot = graph.out_start[from];
+
+  while( (out_spot < graph.out_start[from + 1]) &&
+         (track_to(graph.out_track[out_spot]) != to) )
+    out_spot++;
+
+  if(out_spot == graph.out_start[from + 1])
+    return false;
+
+  /**************************************************************************
+   * There's only ever one track between two switches (two would be a
+   * loop), so a switch set to the other end of this one wouldn't have a
+   * track to or from what it's set to any more. That's fine for a switch
+   * with no tracks left at all, since check_yard doesn't look at those.
+   **************************************************************************/
+
+  if( ((graph.default_setting[from] == to) &&
+       (graph.out_degree[from] + graph.in_degree[from] > 1)) ||
+      ((graph.default_setting[to] == from) &&
+       (graph.out_degree[to] + graph.in_degree[to] > 1)) )
+    return false;
+
+  int in_spot = graph.in_start[to];
+
+  while(graph.in_track[in_spot] != from)
+    in_spot++;
+
+  graph.out_track.erase(graph.out_track.begin() + out_spot);
+  graph.in_track.erase(graph.in_track.begin() + in_spot);
+
+  for(int sw = from + 1; sw <= graph.switches_used + 1; sw++)
+    graph.out_start[sw]--;
+
+  for(int sw = to + 1; sw <= graph.switches_used + 1; sw++)
+    graph.in_start[sw]--;
+
+  graph.out_degree[from]--;
+  graph.in_degree[to]--;
+
+  if(graph.in_degree[to] == 0)
+    graph.sources.insert(lower_bound(graph.sources.begin(),
+                                     graph.sources.end(), to), to);
+
+  mark_track_costs(graph, from);
+  mark_with_feeders(yard, from);
+
+  return true;
+}
+
+/******************************************************************************
+* mark_with_feeders
+* Marks switch_num, and every switch with a track into it, for resolve_yard.
+******************************************************************************/
+
+void mark_with_feeders(solved_yard &yard, int switch_num)
+{
+  const track_graph &graph = yard.system.graph;
+
+  mark_dirty(yard, switch_num);
+
+  for(int track = graph.in_start[switch_num];
+      track < graph.in_start[switch_num + 1]; track++)
+    mark_dirty(yard, graph.in_track[track]);
+}
+
+/******************************************************************************
+* mark_dirty
+* Puts switch_num on the list of switches resolve_yard has to redo, unless
+* it's already there.
+******************************************************************************/
+
+void mark_dirty(solved_yard &yard, int switch_num)
+{
+  if(yard.queued[switch_num])
+    return;
+
+  yard.queued[switch_num] = true;
+  yard.dirty.push(yard.position[switch_num]);
+}
+
+/******************************************************************************
+* resolve_yard
+* Brings the answer up to date after set_default and close_track.
+*
+* The marked switches get their exit_cost worked out again, last in the
+* order (furthest down the hill) first, so everything below a switch is
+* already right when we get to it. If a switch's cost didn't change, nothing
+* above it has to change either, so the work stops there. If it did, the
+* switches right above it get marked too.
+******************************************************************************/
+
+void resolve_yard(solved_yard &yard)
+{
+  track_system &system = yard.system;
+  const track_graph &graph = system.graph;
+
+  clear_stats(graph.stats);
+
+  while(!yard.dirty.empty())
+  {
+    int from = yard.order[yard.dirty.top()];
+
+    yard.dirty.pop();
+    yard.queued[from] = false;
+
+    graph.stats.arrivals++;
+
+    int cost = switch_exit_cost(graph, from, yard.exit_cost);
+
+    if(cost == yard.exit_cost[from])
+      continue;
+
+    yard.exit_cost[from] = cost;
+
+    for(int track = graph.in_start[from]; track < graph.in_start[from + 1];
+        track++)
+      mark_dirty(yard, graph.in_track[track]);
+  }
+
+  system.starting_switch = get_starting(graph);
+  walk_best_path(graph, system.starting_switch, yard.exit_cost,
+                 system.lowest_switches, system.best_answer);
+}
+
+/******************************************************************************
+* create_solver
+* Makes a new track_solver, with no yard in it yet.
+******************************************************************************/
+
+track_solver *create_solver()
+{
+  track_solver *solver = new track_solver;
+
+  start_yard(solver, 1);
+
+  return solver;
+}
+
+/******************************************************************************
+* destroy_solver
+* Gives back everything create_solver made.
+******************************************************************************/
+
+void destroy_solver(track_solver *solver)
+{
+  delete solver;
+}
+
+/******************************************************************************
+* start_yard
+* Throws out whatever yard solver had and gets ready for a new one with
+* switches_used switches. (The memory stays, for the next yard to use.)
+* switches_used is kept between 1 and LARGEST_INPUT, the same as a number
+* in cymbal.in, so every track add_switch takes still fits next to its
+* cost bits (see EDGE_SHIFT).
+******************************************************************************/
+
+void start_yard(track_solver *solver, int switches_used)
+{
+  start_graph(solver->yard.system.graph,
+              min(max(switches_used, 1), LARGEST_INPUT));
+
+  solver->switches_added = 0;
+  solver->solved = false;
+}
+
+/******************************************************************************
+* add_switch
+* Adds the next switch to the yard, just like its line in cymbal.in: where
+* it's set to, and the how_many switches in tracks that it has tracks down
+* to. Switches have to be added in order, starting with 1.
+*
+* Returns false (and adds nothing) if switch_num isn't the next switch, or
+* if any of the numbers isn't a switch in this yard.
+******************************************************************************/
+
+bool add_switch(track_solver *solver,
+				int switch_num,
+				int default_setting,
+				const int *tracks,
+				int how_many)
+{
+  track_graph &graph = solver->yard.system.graph;
+
+  if( (switch_num != solver->switches_added + 1) ||
+      (switch_num > graph.switches_used) ||
+      (default_setting < 1) || (default_setting > graph.switches_used) ||
+      (how_many < 0) )
+    return false;
+
+  for(int c_count = 0; c_count < how_many; c_count++)
+    if( (tracks[c_count] < 1) || (tracks[c_count] > graph.switches_used) )
+      return false;
+
+  for(int c_count = 0; c_count < how_many; c_count++)
+    graph.out_track.push_back(tracks[c_count] << EDGE_SHIFT);
+
+  graph.out_start[switch_num + 1] = graph.out_track.size();
+  graph.default_setting[switch_num] = default_setting;
+
+  finish_switch(graph, switch_num);
+
+  solver->switches_added++;
+
+  return true;
+}
+
+/******************************************************************************
+* update_solver
+* Gets the yard's costs up to date. The first time after start_yard, that
+* means solving all of it (solve_yard). After change_default or
+* remove_track, only the part they changed (resolve_yard). Otherwise
+* there's nothing to do.
+*
+* Returns false if not every switch has been added yet, or the yard is
+* broken (see check_yard).
+******************************************************************************/
+
+bool update_solver(track_solver *solver)
+{
+  solved_yard &yard = solver->yard;
+  track_graph &graph = yard.system.graph;
+
+  if(!solver->solved)
+  {
+    if(solver->switches_added != graph.switches_used)
+      return false;
+
+    build_in_tracks(graph);
+    build_degree_index(graph);
+
+    if(!check_yard(graph, yard.in_degree, yard.system.problem))
+      return false;
+
+    solve_yard(yard);
+
+    solver->solved = true;
+  }
+  else if(!yard.dirty.empty())
+    resolve_yard(yard);
+
+  return true;
+}
+
+/******************************************************************************
+* solve_route
+* Solves the yard and puts Skippy's route in route.
+*
+* Returns false if not every switch has been added yet, or the yard is
+* broken (see check_yard).
+******************************************************************************/
+
+bool solve_route(track_solver *solver, track_route &route)
+{
+  if(!update_solver(solver))
+    return false;
+
+  fill_route(solver, solver->yard.system.starting_switch, route);
+
+  return true;
+}
+
+/******************************************************************************
+* solve_route_from
+* Like solve_route, but for a cart starting at starting_switch instead of
+* Skippy. Every switch's cost is already worked out, so this is just a walk
+* down the best path.
+*
+* Returns false if not every switch has been added yet, the yard is
+* broken, or starting_switch isn't a switch.
+******************************************************************************/
+
+bool solve_route_from(track_solver *solver, int starting_switch,
+					  track_route &route)
+{
+  if( (starting_switch < 1) ||
+      (starting_switch > solver->yard.system.graph.switches_used) ||
+      !update_solver(solver) )
+    return false;
+
+  fill_route(solver, starting_switch, route);
+
+  return true;
+}
+
+/******************************************************************************
+* route_cost
+* How many flips it takes to get out starting from starting_switch, without
+* the route. Once the yard is solved that's one look up.
+*
+* Returns -1 if not every switch has been added yet, the yard is broken,
+* or starting_switch isn't a switch.
+******************************************************************************/
+
+int route_cost(track_solver *solver, int starting_switch)
+{
+  if( (starting_switch < 1) ||
+      (starting_switch > solver->yard.system.graph.switches_used) ||
+      !update_solver(solver) )
+    return -1;
+
+  return solver->yard.exit_cost[starting_switch];
+}
+
+/******************************************************************************
+* fill_route
+* Puts the best route from starting_switch in route, once the yard's costs
+* are up to date.
+******************************************************************************/
+
+void fill_route(track_solver *solver, int starting_switch,
+				track_route &route)
+{
+  const track_graph &graph = solver->yard.system.graph;
+
+  walk_best_path(graph, starting_switch, solver->yard.exit_cost, route.flips,
+                 route.path);
+
+  route.starting_switch = starting_switch;
+  route.thrown.clear();
+  route.thrown_to.clear();
+
+  /**************************************************************************
+   * Which switches get thrown, and to where. These are the same checks as
+   * step_cost: forward switches are thrown to the next switch, backward
+   * ones to the last.
+   **************************************************************************/
+
+  for(int index = 0; index < (int)route.path.size(); index++)
+  {
+    int sw = route.path[index];
+
+    if( (graph.out_degree[sw] > 1) && (index + 1 < (int)route.path.size()) &&
+        (graph.default_setting[sw] != route.path[index + 1]) )
+    {
+      route.thrown.push_back(sw);
+      route.thrown_to.push_back(route.path[index + 1]);
+    }
+    else if( (graph.out_degree[sw] <= 1) && (index > 0) &&
+             (graph.default_setting[sw] != route.path[index - 1]) )
+    {
+      route.thrown.push_back(sw);
+      route.thrown_to.push_back(route.path[index - 1]);
+    }
+  }
+}
+
+/******************************************************************************
+* change_default
+* Sets a switch in a solved yard to new_default for good (see set_default).
+* The next solve_route only works out what that changed. Returns false if
+* the yard hasn't been solved yet, either number isn't a switch, or the
+* switch has no track to or from new_default.
+******************************************************************************/
+
+bool change_default(track_solver *solver, int switch_num, int new_default)
+{
+  if(!solver->solved)
+    return false;
+
+  return set_default(solver->yard, switch_num, new_default);
+}
+
+/******************************************************************************
+* remove_track
+* Closes the track from "from" to "to" in a solved yard (see close_track).
+* The next solve_route only works out what that changed. Returns false if
+* the yard hasn't been solved yet, there's no such track, or either end of
+* it is set to the other (change_default it first).
+******************************************************************************/
+
+bool remove_track(track_solver *solver, int from, int to)
+{
+  if(!solver->solved)
+    return false;
+
+  return close_track(solver->yard, from, to);
+}
+
+/******************************************************************************
+* print_route
+* Puts Skippy's route on the end of out, exactly the way cymbal prints it,
+* as "Track System t_count:". Call solve_route first.
+******************************************************************************/
+
+void print_route(track_solver *solver, int t_count, string &out)
+{
+  solver->yard.system.t_count = t_count;
+
+  print_track_system(out, solver->yard.system);
+}
+
+/******************************************************************************
+* score_routes
+* Works out what each of the routes it's handed throws (see score_paths),
+* for something that plans the carts' routes itself and only wants them
+* checked. Route R is path[route_start[R]] up to (not including)
+* path[route_start[R + 1]], from where the cart is to the exit. So
+* route_start needs routes + 1 numbers, and path needs at least
+* route_start[routes] switches in it (there's no way to check that from
+* here).
+*
+* Returns false if not every switch has been added yet, the yard is
+* broken (see check_yard), or route_start goes backwards or below 0. The
+* first call solves the yard too, since that's what gets the tracks' costs
+* ready.
+******************************************************************************/
+
+bool score_routes(track_solver *solver,
+				  const int *path,
+				  const int *route_start,
+				  int routes,
+				  route_scores &scores)
+{
+  if(!update_solver(solver))
+    return false;
+
+  return score_paths(solver->yard.system.graph, path, route_start, routes,
+                     scores);
+}
+
+/******************************************************************************
+* score_paths
+* The flips, and the switches thrown, for a whole batch of routes at once
+* (laid out like score_routes says). A route that names a switch that isn't
+* there, goes down a track that isn't there, or doesn't end at an exit
+* gets NOT_A_ROUTE and nothing thrown. Returns false, without scoring any
+* of them, if route_start goes backwards or below 0, since then there's no
+* telling where the routes are. path is trusted to be as long as
+* route_start says.
+*
+* Nothing here has to be worked out again: every track in out_track
+* already has its cost bits (see track_cost_bits), which are the rules
+* fill_route and the printing go by. EDGE_FORWARD_FLIP says the switch a
+* track leaves has to be thrown to it, EDGE_BACKWARD_FLIP says the switch
+* it goes to has to be thrown back. So each step of a route is finding its
+* track, and adding up two bits.
+*
+* The routes come in one long array, and so do the answers, so there's no
+* memory asked for per route. The loop over a route's steps doesn't stop
+* to ask anything either: a missing track just comes back as 0 (no cost
+* bits), and clears ok. Every step writes where the next thrown switches
+* would go, and only moves along for the ones really thrown. One step can
+* throw two (the switch it leaves and the one it comes to), so there's room
+* for two for every switch in the routes, whatever the cost bits say.
+******************************************************************************/
+
+bool score_paths(const track_graph &graph,
+				 const int *path,
+				 const int *route_start,
+				 int routes,
+				 route_scores &scores)
+{
+  if( (routes < 0) || ((routes > 0) && (route_start[0] < 0)) )
+    return false;
+
+  for(int route = 0; route < routes; route++)
+    if(route_start[route + 1] < route_start[route])
+      return false;
+
+  size_t most_thrown = (routes > 0) ?
+                       2 * (size_t)(route_start[routes] - route_start[0]) : 0;
+  int thrown = 0;
+
+  scores.flips.resize(routes);
+  scores.thrown_start.resize(routes + 1);
+  scores.thrown.resize(max(most_thrown, (size_t)1));
+  scores.thrown_to.resize(max(most_thrown, (size_t)1));
+
+  int *thrown_switch = scores.thrown.data();
+  int *thrown_to = scores.thrown_to.data();
+
+  for(int route = 0; route < routes; route++)
+  {
+    int first = route_start[route];
+    int last = route_start[route + 1] - 1;
+    bool ok = (last >= first);
+    int flips = NOTHING_DONE;
+
+    scores.thrown_start[route] = thrown;
+
+    for(int index = first; index <= last; index++)
+      ok &= ((unsigned)(path[index] - 1) < (unsigned)graph.switches_used);
+
+    if(!ok || (graph.out_degree[path[last]] != 0))
+    {
+      scores.flips[route] = NOT_A_ROUTE;
+      continue;
+    }
+
+    for(int index = first; index < last; index++)
+    {
+      int from = path[index];
+      int to = path[index + 1];
+      int track = find_track(graph, from, to);
+      int forward = ((track & EDGE_FORWARD_FLIP) != 0);
+      int backward = ((track & EDGE_BACKWARD_FLIP) != 0);
+
+      ok &= (track != 0);
+      flips += forward + backward;
+
+      thrown_switch[thrown] = from;
+      thrown_to[thrown] = to;
+      thrown += forward;
+
+      thrown_switch[thrown] = to;
+      thrown_to[thrown] = from;
+      thrown += backward;
+    }
+
+    if(!ok)
+    {
+      flips = NOT_A_ROUTE;
+      thrown = scores.thrown_start[route];
+    }
+
+    scores.flips[route] = flips;
+  }
+
+  scores.thrown_start[routes] = thrown;
+  scores.thrown.resize(thrown);
+  scores.thrown_to.resize(thrown);
+
+  return true;
+}
+
+/******************************************************************************
+* find_track
+* The track from "from" to "to", cost bits and all, or 0 if there isn't
+* one. A switch only has a few tracks, so it looks at all of them rather
+* than guessing which one it'll be.
+******************************************************************************/
+
+inline int find_track(const track_graph &graph, int from, int to)
+{
+  int found = 0;
+
+  for(int track = graph.out_start[from]; track < graph.out_start[from + 1];
+      track++)
+    found |= (track_to(graph.out_track[track]) == to) ?
+             graph.out_track[track] : 0;
+
+  return found;
+}
+
+/******************************************************************************
+* make_scale_yard
+* Builds a made up yard with switches_used switches for -scale.
+*
+* Switch A always connects to A + 1, so there's one long downhill chain, and
+* sometimes also branches to a couple of switches a little further down
+* (never past the last switch, which is the only exit). Branching switches
+* default to a random track. The others look "backward" at the switch right
+* above them, so a cart coming in from a branch has to throw them.
+*
+* The random numbers come from a plain linear congruential generator so the
+* same size always gets the same yard.
+******************************************************************************/
+
+void make_scale_yard(track_graph &graph, int switches_used)
+{
+  unsigned int seed = switches_used;
+
+  start_graph(graph, switches_used);
+
+  for(int sw = 1; sw <= switches_used; sw++)
+  {
+    int tracks = NOTHING_DONE;
+
+    if(sw < switches_used)
+    {
+      seed = seed * 1103515245 + 12345;
+      tracks = 1 + (seed >> 16) % SCALE_BRANCHES;
+
+      if(tracks > switches_used - sw)
+        tracks = switches_used - sw;
+    }
+
+    for(int track = 1; track <= tracks; track++)
+      graph.out_track.push_back((sw + track) << EDGE_SHIFT);
+
+    graph.out_start[sw + 1] = graph.out_track.size();
+
+    if(tracks > 1)
+    {
+      seed = seed * 1103515245 + 12345;
+      graph.default_setting[sw] = sw + 1 + (seed >> 16) % tracks;
+    }
+    else
+      graph.default_setting[sw] = sw - 1;
+
+    finish_switch(graph, sw);
+  }
+
+  build_in_tracks(graph);
+  build_degree_index(graph);
+}
+
+/******************************************************************************
+* run_scale_benchmark
+* Times how long it takes to build and solve bigger and bigger yards with
+* solve_by_dp and prints one line per size. The memory column is what the
+* track_graph holds (the degree index too), so it should grow with the
+* number of switches and tracks, not the square of it. "B/track" is that
+* spread over the tracks, and "Mtrack/s" is how many million tracks a
+* second solve_by_dp got through.
+*
+* solve_for_one_switch isn't timed here: on yards this size it would be
+* trying paths until the end of time.
+******************************************************************************/
+
+void run_scale_benchmark()
+{
+  cout << setw(10) << "switches" << setw(10) << "tracks"
+       << setw(12) << "build ms" << setw(12) << "solve ms"
+       << setw(8) << "flips" << setw(12) << "graph MB" << setw(10)
+       << "B/track" << setw(10) << "Mtrack/s" << endl;
+
+  for(int switches_used = SCALE_SMALLEST; switches_used <= SCALE_LARGEST;
+      switches_used *= 10)
+  {
+    track_graph graph;
+    vector<int> best_answer;
+    int lowest_switches = LARGE_NUMBER;
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    make_scale_yard(graph, switches_used);
+
+    chrono::steady_clock::time_point built = chrono::steady_clock::now();
+
+    solve_by_dp(graph, get_starting(graph), lowest_switches, best_answer);
+
+    chrono::steady_clock::time_point solved = chrono::steady_clock::now();
+
+    double graph_bytes = sizeof(int) * (graph.default_setting.size() +
+                                        graph.out_start.size() +
+                                        graph.out_track.size() +
+                                        graph.in_start.size() +
+                                        graph.in_track.size() +
+                                        graph.out_degree.size() +
+                                        graph.in_degree.size() +
+                                        graph.sources.size());
+    double solve_ms = chrono::duration<double, milli>(solved -
+                                                      built).count();
+
+    cout << setw(10) << switches_used
+         << setw(10) << graph.out_track.size() << fixed << setprecision(2)
+         << setw(12)
+         << chrono::duration<double, milli>(built - start).count()
+         << setw(12) << solve_ms
+         << setw(8) << lowest_switches
+         << setw(12) << graph_bytes / (1024 * 1024)
+         << setw(10) << graph_bytes / graph.out_track.size()
+         << setw(10) << graph.out_track.size() / (solve_ms * 1000) << endl;
+  }
+}
+
+/******************************************************************************
+* run_parse_benchmark
+* Reads the file called name over and over, first with ifstream and then
+* with track_reader, until each has gone through about PARSE_BENCH_BYTES,
+* and prints how many megabytes a second each one managed.
+*
+* ifstream can't read a compiled file, so for one of those only loading it
+* through track_reader is timed.
+******************************************************************************/
+
+void run_parse_benchmark(const char *name)
+{
+  track_reader reader;
+
+  if(!open_reader(reader, name))
+    return;
+
+  while(peek_char(reader) != EOF)
+    reader.pos = reader.end;
+
+  long long file_bytes = reader.bytes;
+  bool compiled = (reader.mapped != NULL);
+  close_reader(reader);
+
+  if(file_bytes == 0)
+  {
+    cerr << name << ": it's empty" << endl;
+    return;
+  }
+
+  long long repeats = PARSE_BENCH_BYTES / file_bytes + 1;
+  double seconds[2];
+  track_graph graph;
+
+  const char *reader_name[2] = { "ifstream",
+                                 compiled ? "compiled" : "track_reader" };
+
+  for(int which = compiled ? 1 : 0; which < 2; which++)
+  {
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    for(long long repeat = 0; repeat < repeats; repeat++)
+    {
+      int total_systems = 0;
+
+      if(which == 0)
+      {
+        ifstream infile(name);
+
+        infile >> total_systems;
+
+        for(int t_count = 1; t_count <= total_systems; t_count++)
+          read_track_system(infile, graph);
+      }
+      else
+      {
+        open_reader(reader, name);
+        read_system_count(reader, false, total_systems);
+
+        for(int t_count = 1; t_count <= total_systems; t_count++)
+          if(!read_track_system(reader, graph))
+            break;
+
+        close_reader(reader);
+      }
+    }
+
+    seconds[which] = chrono::duration<double>(chrono::steady_clock::now() -
+                                              start).count();
+  }
+
+  double megabytes = (double)file_bytes * repeats / (1024 * 1024);
+
+  cout << name << ": " << file_bytes << " bytes, read " << repeats
+       << " times" << endl << fixed << setprecision(1);
+
+  for(int which = compiled ? 1 : 0; which < 2; which++)
+    cout << setw(14) << reader_name[which] << setw(10)
+         << megabytes / seconds[which] << " MB/s" << endl;
+}
+
+/******************************************************************************
+* next_random
+* Moves seed along (the same linear congruential generator make_scale_yard
+* uses) and returns a number from 0 up to below - 1.
+******************************************************************************/
+
+unsigned int next_random(unsigned int &seed, unsigned int below)
+{
+  seed = seed * 1103515245 + 12345;
+
+  return (seed >> 16) % below;
+}
+
+/******************************************************************************
+* make_random_yard
+* Builds a made up yard shaped like shape says, for -generate and -bench.
+*
+* Every track goes to a higher numbered switch, so carts can only roll
+* downhill and there are no loops. Every switch but the last has at least
+* one track, so the last switch is the only exit and every route gets
+* there.
+*
+* next_new is the first switch that nothing runs into yet. A track either
+* goes there (and next_new moves on), or, merge_percent of the time, goes to
+* one of the switches between here and next_new, which something already
+* runs into. Since next_new is always past the switch we're on, every switch
+* but switch 1 gets a track into it, and switch 1 is where Skippy starts.
+*
+* came_from is which switch a backward default should point at. Each track
+* into a switch replaces it with 1 / (tracks so far) odds, so it ends up
+* being any of them equally often.
+******************************************************************************/
+
+void make_random_yard(track_graph &graph, const yard_shape &shape)
+{
+  int switches_used = shape.switches_used;
+  unsigned int seed = shape.seed;
+  int next_new = 2;
+
+  vector<int> came_from(switches_used + 1, NOTHING_DONE);
+  vector<int> tracks_in(switches_used + 1, NOTHING_DONE);
+
+  start_graph(graph, switches_used);
+
+  for(int sw = 1; sw <= switches_used; sw++)
+  {
+    int first = graph.out_track.size();
+    int tracks = NOTHING_DONE;
+
+    if(sw < switches_used)
+      tracks = min(1 + (int)next_random(seed, shape.branches),
+                   switches_used - sw);
+
+    for(int track = 1; track <= tracks; track++)
+    {
+      int to;
+
+      if( (next_new > sw + 1) &&
+          ((int)next_random(seed, 100) < shape.merge_percent) )
+        to = sw + 1 + next_random(seed, next_new - sw - 1);
+      else if(next_new <= switches_used)
+        to = next_new++;
+      else
+        to = sw + 1 + next_random(seed, switches_used - sw);
+
+      graph.out_track.push_back(to << EDGE_SHIFT);
+
+      if(next_random(seed, ++tracks_in[to]) == 0)
+        came_from[to] = sw;
+    }
+
+    graph.out_start[sw + 1] = graph.out_track.size();
+
+    /**************************************************************************
+     * Pick the default. A switch with one track leaving it always looks
+     * back up one coming into it (except switch 1, where nothing comes in).
+     **************************************************************************/
+
+    int left = graph.out_start[sw + 1] - first;
+    bool forward = (came_from[sw] == NOTHING_DONE) ||
+                   ( (left > 1) &&
+                     ((int)next_random(seed, 100) < shape.forward_percent) );
+
+    if(sw == switches_used)
+      graph.default_setting[sw] = came_from[sw];
+    else if(forward)
+      graph.default_setting[sw] =
+        track_to(graph.out_track[first + next_random(seed, left)]);
+    else
+      graph.default_setting[sw] = came_from[sw];
+
+    finish_switch(graph, sw);
+  }
+
+  build_in_tracks(graph);
+  build_degree_index(graph);
+}
+
+/******************************************************************************
+* append_yard
+* Puts graph on the end of out, written the way the input file has it.
+******************************************************************************/
+
+void append_yard(string &out, const track_graph &graph)
+{
+  append_number(out, graph.switches_used);
+  out += '\n';
+
+  for(int sw = 1; sw <= graph.switches_used; sw++)
+  {
+    append_number(out, graph.default_setting[sw]);
+    out += ' ';
+    append_number(out, graph.out_start[sw + 1] - graph.out_start[sw]);
+
+    for(int track = graph.out_start[sw]; track < graph.out_start[sw + 1];
+        track++)
+    {
+      out += ' ';
+      append_number(out, track_to(graph.out_track[track]));
+    }
+
+    out += '\n';
+  }
+}
+
+/******************************************************************************
+* generate_yards
+* For -generate: writes a whole input file with total_systems made up yards
+* to writer. Each system gets the next seed, so they aren't all the same.
+******************************************************************************/
+
+void generate_yards(track_writer &writer, yard_shape shape,
+					int total_systems)
+{
+  track_graph graph;
+
+  append_number(writer.buffer, total_systems);
+  writer.buffer += '\n';
+
+  for(int t_count = 1; t_count <= total_systems; t_count++)
+  {
+    make_random_yard(graph, shape);
+    append_yard(writer.buffer, graph);
+    write_output(writer, false);
+
+    shape.seed++;
+  }
+}
+
+/******************************************************************************
+* run_phase_benchmark
+* For -bench: for every size from BENCH_SMALLEST up to BENCH_LARGEST
+* switches, writes a file with about BENCH_SWITCHES switches worth of yards
+* shaped like shape, then times the three things main does with it one at
+* a time:
+*
+*		parse: read every system with track_reader,
+*		solve: solve every system the way main does (solve_track_system,
+*			   so yards solve_small_yard can take go there and the rest
+*			   to solve_by_dp), again with solve_for_one_switch_memo,
+*			   and again with solve_for_one_switch if the yards are
+*			   small enough,
+*		print: print every answer with print_track_system.
+*
+* Then it goes through the file once more the way main does, reading,
+* solving and printing each system into one track_system that gets reused,
+* and counts how many times that asked for memory (allocs). That shouldn't
+* grow with the number of systems, only with how big the biggest one is.
+*
+* The file is a real (temporary) file, so reading it goes through the same
+* read() calls as cymbal.in would. The routes the other solvers find are
+* compared with the first one's too, since a benchmark that gets faster by
+* getting the wrong answer isn't much use.
+******************************************************************************/
+
+void run_phase_benchmark(yard_shape shape)
+{
+  cout << setw(10) << "switches" << setw(9) << "systems" << setw(9) << "MB"
+       << setw(11) << "parse ms" << setw(11) << "dp ms" << setw(11)
+       << "memo ms" << setw(11) << "dfs ms" << setw(11) << "print ms"
+       << setw(9) << "allocs" << endl;
+
+  solve_options dp_options;
+  solve_options dfs_options;
+  solve_options memo_options;
+
+  dp_options.use_dfs = false;
+  dp_options.memo = false;
+  dp_options.search_threads = 1;
+  dp_options.all_starts = false;
+  dp_options.every_switch = false;
+  dp_options.routes = 0;
+  dp_options.ties = false;
+  dp_options.budget = 0;
+  dp_options.small_yards = true;
+  dfs_options = dp_options;
+  dfs_options.use_dfs = true;
+  memo_options = dfs_options;
+  memo_options.memo = true;
+
+  for(int switches_used = BENCH_SMALLEST; switches_used <= BENCH_LARGEST;
+      switches_used *= 10)
+  {
+    int total_systems = max(BENCH_SWITCHES / switches_used, 1);
+    FILE *file = tmpfile();
+
+    if(file == NULL)
+    {
+      cerr << "-bench: can't make a temporary file" << endl;
+      return;
+    }
+
+    track_writer writer;
+
+    writer.file = file;
+    shape.switches_used = switches_used;
+
+    generate_yards(writer, shape, total_systems);
+    write_output(writer, true);
+    lseek(fileno(file), 0, SEEK_SET);
+
+    /**************************************************************************
+     * parse
+     **************************************************************************/
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+    track_reader reader;
+    vector<track_system> systems(total_systems);
+    int read_total = 0;
+
+    start_reader(reader, fileno(file), "-bench");
+    read_number(reader, read_total, false);
+    end_line(reader);
+
+    for(int t_count = 1; t_count <= total_systems; t_count++)
+    {
+      systems[t_count - 1].t_count = t_count;
+      read_track_system(reader, systems[t_count - 1].graph);
+    }
+
+    chrono::steady_clock::time_point parsed = chrono::steady_clock::now();
+
+    /**************************************************************************
+     * solve (and check against the other solver). Whichever solver goes
+     * first leaves the order it works out in graph.order, so every one of
+     * them starts without it, like a system that was just read, and pays
+     * for its own topological sort.
+     **************************************************************************/
+
+    for(int index = 0; index < total_systems; index++)
+      systems[index].graph.order.clear();
+
+    chrono::steady_clock::time_point dp_start = chrono::steady_clock::now();
+
+    for(int index = 0; index < total_systems; index++)
+      solve_track_system(systems[index], dp_options);
+
+    chrono::steady_clock::time_point solved = chrono::steady_clock::now();
+    vector<vector<int> > dp_answers(total_systems);
+
+    for(int index = 0; index < total_systems; index++)
+      dp_answers[index].swap(systems[index].best_answer);
+
+    for(int index = 0; index < total_systems; index++)
+      systems[index].graph.order.clear();
+
+    chrono::steady_clock::time_point memo_start = chrono::steady_clock::now();
+
+    for(int index = 0; index < total_systems; index++)
+      solve_track_system(systems[index], memo_options);
+
+    double memo_ms = chrono::duration<double, milli>(
+                       chrono::steady_clock::now() - memo_start).count();
+
+    for(int index = 0; index < total_systems; index++)
+      if(dp_answers[index] != systems[index].best_answer)
+        cerr << "-bench: the memoized search disagrees on a "
+             << switches_used << " switch yard (seed " << shape.seed + index
+             << ")" << endl;
+
+    double dfs_ms = -1;
+
+    if(switches_used <= BENCH_DFS_LARGEST)
+    {
+      for(int index = 0; index < total_systems; index++)
+        systems[index].graph.order.clear();
+
+      chrono::steady_clock::time_point dfs_start =
+        chrono::steady_clock::now();
+
+      for(int index = 0; index < total_systems; index++)
+        solve_track_system(systems[index], dfs_options);
+
+      dfs_ms = chrono::duration<double, milli>(chrono::steady_clock::now() -
+                                               dfs_start).count();
+
+      for(int index = 0; index < total_systems; index++)
+        if(dp_answers[index] != systems[index].best_answer)
+          cerr << "-bench: the solvers disagree on a " << switches_used
+               << " switch yard (seed " << shape.seed + index << ")" << endl;
+    }
+
+    /**************************************************************************
+     * print
+     **************************************************************************/
+
+    chrono::steady_clock::time_point print_start = chrono::steady_clock::now();
+    string out;
+
+    for(int index = 0; index < total_systems; index++)
+      print_track_system(out, systems[index]);
+
+    chrono::steady_clock::time_point printed = chrono::steady_clock::now();
+
+    /**************************************************************************
+     * all of it again, like main
+     **************************************************************************/
+
+    track_system system;
+    long long main_allocations = allocations;
+
+    lseek(fileno(file), 0, SEEK_SET);
+    start_reader(reader, fileno(file), "-bench");
+    read_number(reader, read_total, false);
+    end_line(reader);
+
+    for(int t_count = 1; t_count <= total_systems; t_count++)
+    {
+      system.t_count = t_count;
+      read_track_system(reader, system.graph);
+      solve_track_system(system, dp_options);
+
+      out.clear();
+      print_answer(out, system, dp_options);
+    }
+
+    main_allocations = allocations - main_allocations;
+
+    fclose(file);
+
+    cout << setw(10) << switches_used << setw(9) << total_systems
+         << fixed << setprecision(2)
+         << setw(9) << reader.bytes / (1024.0 * 1024.0)
+         << setw(11) << chrono::duration<double, milli>(parsed - start).count()
+         << setw(11) << chrono::duration<double, milli>(solved -
+                                                        dp_start).count()
+         << setw(11) << memo_ms;
+
+    if(dfs_ms < 0)
+      cout << setw(11) << "-";
+    else
+      cout << setw(11) << dfs_ms;
+
+    cout << setw(11)
+         << chrono::duration<double, milli>(printed - print_start).count()
+         << setw(9) << main_allocations << endl;
+  }
+}
+
+/******************************************************************************
+* check_route
+* For -check: makes sure line (the second line of a "Track System N:"
+* block) is a right answer for graph, without trusting anything a solver
+* worked out. It returns false, with what's wrong in problem, unless:
+*
+*		every switch it names is a switch in graph,
+*		each one has a track down to the next, starting from where Skippy
+*		is and ending at an exit, and
+*		exactly the switches that have to be thrown to go that way are
+*		printed with (x), and they're thrown the right way.
+*
+* The route is the switches written without ( ) around them, in order.
+* Skippy's switch is only printed if it has more than one track leaving it,
+* so if the first one isn't him, he goes in front.
+*
+* flips gets how many switches the route throws.
+******************************************************************************/
+
+bool check_route(const track_graph &graph,
+				 int starting_switch,
+				 const string &line,
+				 int &flips,
+				 string &problem)
+{
+  istringstream in(line);
+  string token;
+
+  vector<int> path;
+  vector<int> thrown_back;
+  vector<int> thrown_to;
+
+  /**************************************************************************
+   * Split up the line. Each word is "A", "(B)A" or "A(B)".
+   **************************************************************************/
+
+  while(in >> token)
+  {
+    int back = NO_THROW;
+    int to = NO_THROW;
+    int sw = NO_THROW;
+    int used = 0;
+
+    if( (sscanf(token.c_str(), "(%d)%d%n", &back, &sw, &used) != 2) ||
+        (used != (int)token.size()) )
+    {
+      back = NO_THROW;
+      used = 0;
+
+      if( (sscanf(token.c_str(), "%d(%d)%n", &sw, &to, &used) != 2) ||
+          (used != (int)token.size()) )
+      {
+        to = NO_THROW;
+        used = 0;
+
+        if( (sscanf(token.c_str(), "%d%n", &sw, &used) != 1) ||
+            (used != (int)token.size()) )
+        {
+          problem = "can't read '" + token + "'";
+          return false;
+        }
+      }
+    }
+
+    if( (sw < 1) || (sw > graph.switches_used) )
+    {
+      problem = "'" + token + "' isn't a switch in this system";
+      return false;
+    }
+
+    path.push_back(sw);
+    thrown_back.push_back(back);
+    thrown_to.push_back(to);
+  }
+
+  if(path.empty() || (path[0] != starting_switch))
+  {
+    if(graph.out_degree[starting_switch] > 1)
+    {
+      problem = "it should start by saying how to throw the first switch";
+      return false;
+    }
+
+    path.insert(path.begin(), starting_switch);
+    thrown_back.insert(thrown_back.begin(), NO_THROW);
+    thrown_to.insert(thrown_to.begin(), NO_THROW);
+  }
+
+  /**************************************************************************
+   * Now walk it, working out what has to be thrown from the spec alone.
+   **************************************************************************/
+
+  flips = NOTHING_DONE;
+
+  for(int index = 0; index < (int)path.size(); index++)
+  {
+    int sw = path[index];
+    int tracks = graph.out_start[sw + 1] - graph.out_start[sw];
+    int need_back = NO_THROW;
+    int need_to = NO_THROW;
+
+    ostringstream where;
+
+    where << "switch " << sw;
+
+    if(index + 1 < (int)path.size())
+    {
+      bool found = false;
+
+      for(int track = graph.out_start[sw]; track < graph.out_start[sw + 1];
+          track++)
+        if(track_to(graph.out_track[track]) == path[index + 1])
+          found = true;
+
+      if(!found)
+      {
+        ostringstream out;
+
+        out << where.str() << " has no track to " << path[index + 1];
+        problem = out.str();
+        return false;
+      }
+
+      if( (tracks > 1) && (graph.default_setting[sw] != path[index + 1]) )
+        need_to = path[index + 1];
+    }
+    else if(tracks != 0)
+    {
+      problem = where.str() + " isn't an exit";
+      return false;
+    }
+
+    if( (tracks <= 1) && (index > 0) &&
+        (graph.default_setting[sw] != path[index - 1]) )
+      need_back = path[index - 1];
+
+    if( (thrown_back[index] != need_back) || (thrown_to[index] != need_to) )
+    {
+      problem = where.str() + " is thrown wrong";
+      return false;
+    }
+
+    if(need_back != NO_THROW)
+      flips++;
+
+    if(need_to != NO_THROW)
+      flips++;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* read_expected
+* For -check -expect: reads a file of answers the way main prints them, and
+* puts the route for "Track System N:" in expected[N]. Systems the file
+* doesn't have are left empty.
+******************************************************************************/
+
+bool read_expected(const char *name, vector<string> &expected)
+{
+  ifstream infile(name);
+  string line;
+
+  if(!infile)
+  {
+    cerr << name << ": can't open it" << endl;
+    return false;
+  }
+
+  expected.clear();
+
+  while(getline(infile, line))
+  {
+    int t_count;
+
+    if(sscanf(line.c_str(), "Track System %d:", &t_count) != 1)
+      continue;
+
+    if(t_count < 1)
+      continue;
+
+    if(!getline(infile, line))
+      line.clear();
+
+    if(!line.empty() && (line[line.size() - 1] == '\r'))
+      line.erase(line.size() - 1);
+
+    if((int)expected.size() <= t_count)
+      expected.resize(t_count + 1);
+
+    expected[t_count] = line;
+  }
+
+  return true;
+}
+
+/******************************************************************************
+* run_check
+* For -check: solves every system from input_name (or generate_systems made
+* up ones shaped like shape) with each solver:
+*
+*		dp:         solve_by_dp,
+*		dfs:        solve_for_one_switch (on systems up to
+*					CHECK_DFS_LARGEST switches),
+*		dfs split:  solve_for_one_switch_threaded, with at least 2 threads,
+*		dfs memo:   solve_for_one_switch_memo,
+*		dp small:   solve_small_yard (bigger systems just get dp again),
+*
+* and runs every printed route through check_route. The route has to be
+* right, throw as many switches as the solver said it would, and throw as
+* few as dp's. If expect_name isn't NULL, the routes in it are checked the
+* same way, and so are the best CHECK_ROUTES from find_best_routes. Those
+* get scored all at once by score_paths too, which has to agree.
+*
+* Then everything is solved again with solve_in_parallel, which has to
+* print exactly what dp printed one at a time.
+*
+* A broken system (see check_yard) is one problem, and isn't solved.
+*
+* Problems go to cerr, a summary to cout. Returns what main should: 0 if
+* everything was fine.
+******************************************************************************/
+
+int run_check(const char *input_name,
+			  bool single_system,
+			  const char *expect_name,
+			  yard_shape shape,
+			  int generate_systems)
+{
+  vector<track_system> systems;
+  vector<string> expected;
+  int problems = 0;
+
+  const char *source = input_name;
+
+  if(generate_systems > 0)
+  {
+    source = "generated";
+    systems.resize(generate_systems);
+
+    for(int index = 0; index < generate_systems; index++)
+    {
+      systems[index].t_count = index + 1;
+      make_random_yard(systems[index].graph, shape);
+
+      shape.seed++;
+    }
+  }
+  else
+  {
+    track_reader reader;
+    int total_systems;
+
+    if(!open_reader(reader, input_name))
+      return 1;
+
+    if(!read_system_count(reader, single_system, total_systems))
+    {
+      close_reader(reader);
+      return 1;
+    }
+
+    for(int t_count = 1; t_count <= total_systems; t_count++)
+    {
+      systems.resize(t_count);
+      systems[t_count - 1].t_count = t_count;
+
+      if(!read_track_system(reader, systems[t_count - 1].graph))
+      {
+        systems.pop_back();
+        problems++;
+        break;
+      }
+    }
+
+    close_reader(reader);
+  }
+
+  if( (expect_name != NULL) && !read_expected(expect_name, expected) )
+    return 1;
+
+  /**************************************************************************
+   * The solvers to check, dp first, since it's the one the others are
+   * compared with.
+   **************************************************************************/
+
+  const int total_solvers = 5;
+  const char *solver_name[total_solvers] = { "dp", "dfs", "dfs split",
+                                             "dfs memo", "dp small" };
+  solve_options solver[total_solvers];
+
+  solver[0].use_dfs = false;
+  solver[0].memo = false;
+  solver[0].search_threads = 1;
+  solver[0].all_starts = false;
+  solver[0].every_switch = false;
+  solver[0].routes = 0;
+  solver[0].ties = false;
+  solver[0].budget = 0;
+  solver[0].small_yards = false;
+
+  solver[1] = solver[0];
+  solver[1].use_dfs = true;
+  solver[2] = solver[1];
+  solver[2].search_threads = max((int)thread::hardware_concurrency(), 2);
+  solver[3] = solver[1];
+  solver[3].memo = true;
+  solver[4] = solver[0];
+  solver[4].small_yards = true;
+
+  vector<string> dp_output(systems.size());
+
+  for(int index = 0; index < (int)systems.size(); index++)
+  {
+    track_system &system = systems[index];
+    int best_flips = LARGE_NUMBER;
+
+    for(int which = 0; which < total_solvers; which++)
+    {
+      if( solver[which].use_dfs && !solver[which].memo &&
+          (system.graph.switches_used > CHECK_DFS_LARGEST) )
+        continue;
+
+      string out;
+      string problem;
+      int flips;
+
+      solve_track_system(system, solver[which]);
+
+      if(!system.problem.empty())
+      {
+        cerr << "Track System " << system.t_count << ": " << system.problem
+             << endl;
+        problems++;
+        break;
+      }
+
+      print_track_system(out, system);
+
+      if(which == 0)
+      {
+        dp_output[index] = out;
+        best_flips = system.lowest_switches;
+      }
+
+      string line = out.substr(out.find('\n') + 1);
+
+      line.erase(line.find('\n'));
+
+      bool route_ok = check_route(system.graph, system.starting_switch, line,
+                                  flips, problem);
+
+      if(route_ok && (flips != system.lowest_switches))
+      {
+        ostringstream message;
+
+        message << "it throws " << flips << " switches, but the solver said "
+                << system.lowest_switches;
+        problem = message.str();
+      }
+      else if(route_ok && (flips != best_flips))
+      {
+        ostringstream message;
+
+        message << "it throws " << flips << " switches, dp only needs "
+                << best_flips;
+        problem = message.str();
+      }
+
+      if(!problem.empty())
+      {
+        cerr << "Track System " << system.t_count << " ("
+             << solver_name[which] << "): " << problem << endl;
+        problems++;
+      }
+    }
+
+    if(!system.problem.empty())
+      continue;
+
+    /************************************************************************
+     * The answer we were told to expect.
+     ************************************************************************/
+
+    if(expect_name != NULL)
+    {
+      string problem;
+      int flips;
+
+      if( (system.t_count >= (int)expected.size()) ||
+          expected[system.t_count].empty() )
+        problem = "it isn't there";
+      else if(check_route(system.graph, system.starting_switch,
+                          expected[system.t_count], flips, problem) &&
+              (flips != best_flips))
+      {
+        ostringstream message;
+
+        message << "it throws " << flips << " switches, dp only needs "
+                << best_flips;
+        problem = message.str();
+      }
+
+      if(!problem.empty())
+      {
+        cerr << "Track System " << system.t_count << " (" << expect_name
+             << "): " << problem << endl;
+        problems++;
+      }
+    }
+
+    /************************************************************************
+     * The best CHECK_ROUTES routes. Every one has to be right and throw as
+     * many switches as find_best_routes said, the first has to be dp's,
+     * and none can throw fewer than the one before it or be one we
+     * already had.
+     ************************************************************************/
+
+    vector<int> order;
+    vector<int> in_degree;
+    vector<int> exit_cost;
+    vector<string> route_lines;
+    route_list routes;
+
+    solve_all_starts(system.graph, order, in_degree, exit_cost);
+    find_best_routes(system.graph, system.starting_switch, exit_cost,
+                     CHECK_ROUTES, false, routes);
+
+    for(int route = 0; route < (int)routes.flips.size(); route++)
+    {
+      string line;
+      string problem;
+      int flips;
+
+      append_route(line, system.graph, &routes.switches[routes.start[route]],
+                   routes.start[route + 1] - routes.start[route]);
+
+      if(!check_route(system.graph, system.starting_switch, line, flips,
+                      problem))
+        problem = "route " + line + ": " + problem;
+      else if(flips != routes.flips[route])
+        problem = "route " + line + " throws a different number of switches"
+                  " than it said";
+      else if( (route == 0) && (flips != best_flips) )
+        problem = "the first route isn't the best";
+      else if( (route > 0) && (flips < routes.flips[route - 1]) )
+        problem = "route " + line + " is better than the one before it";
+
+      if(!problem.empty())
+      {
+        cerr << "Track System " << system.t_count << " (routes): "
+             << problem << endl;
+        problems++;
+      }
+
+      route_lines.push_back(line);
+    }
+
+    sort(route_lines.begin(), route_lines.end());
+
+    if(adjacent_find(route_lines.begin(), route_lines.end()) !=
+       route_lines.end())
+    {
+      cerr << "Track System " << system.t_count
+           << " (routes): a route came out twice" << endl;
+      problems++;
+    }
+
+    /************************************************************************
+     * And score_paths has to agree with all of them, scored as one batch,
+     * down to which switches they throw.
+     ************************************************************************/
+
+    route_scores scores;
+
+    score_paths(system.graph, routes.switches.data(), routes.start.data(),
+                routes.flips.size(), scores);
+
+    for(int route = 0; route < (int)routes.flips.size(); route++)
+    {
+      if( (scores.flips[route] != routes.flips[route]) ||
+          (scores.thrown_start[route + 1] - scores.thrown_start[route] !=
+           routes.flips[route]) )
+      {
+        cerr << "Track System " << system.t_count << " (score_paths): "
+             << "route " << route + 1 << " throws " << scores.flips[route]
+             << " switches, it should be " << routes.flips[route] << endl;
+        problems++;
+      }
+    }
+  }
+
+  /**************************************************************************
+   * And all of them at once, like -threads does.
+   **************************************************************************/
+
+  solve_in_parallel(systems, solver[0],
+                    max((int)thread::hardware_concurrency(), 2));
+
+  for(int index = 0; index < (int)systems.size(); index++)
+  {
+    if(systems[index].output != dp_output[index])
+    {
+      cerr << "Track System " << systems[index].t_count
+           << " (dp -threads): it printed something else" << endl;
+      problems++;
+    }
+  }
+
+  cout << source << ": " << systems.size() << " systems checked";
+
+  if(expect_name != NULL)
+    cout << " against " << expect_name;
+
+  cout << ", " << problems << " problems" << endl;
+
+  return (problems == 0) ? 0 : 1;
+}
+
+/******************************************************************************
+* run_edit_benchmark
+* For -edit-bench: for every size from EDIT_BENCH_SMALLEST up to
+* BENCH_LARGEST switches, makes a yard shaped like shape, solves it with
+* solve_yard, and then makes EDIT_BENCH_EDITS changes to it, one at a time:
+* every other one throws a switch to another of its tracks for good
+* (set_default), the rest close one track off a switch that has more than
+* one (close_track). A change that can't be made (a switch with nothing to
+* throw it to, or a track close_track won't take out) is skipped, so the
+* "edits" column is how many really got made.
+*
+* After every change it times resolve_yard against solving the whole yard
+* again with solve_by_dp, and makes sure they got the same route.
+******************************************************************************/
+
+void run_edit_benchmark(yard_shape shape)
+{
+  cout << setw(10) << "switches" << setw(8) << "edits" << setw(12)
+       << "edit us" << setw(12) << "full us" << setw(10) << "speedup"
+       << setw(10) << "redone" << setw(8) << "wrong" << endl;
+
+  for(int switches_used = EDIT_BENCH_SMALLEST;
+      switches_used <= BENCH_LARGEST; switches_used *= 10)
+  {
+    solved_yard yard;
+    track_graph &graph = yard.system.graph;
+    unsigned int seed = shape.seed;
+
+    shape.switches_used = switches_used;
+    make_random_yard(graph, shape);
+    solve_yard(yard);
+
+    double edit_us = 0;
+    double full_us = 0;
+    long long redone = 0;
+    int wrong = 0;
+    int edits = 0;
+
+    for(int edit = 0; edit < EDIT_BENCH_EDITS; edit++)
+    {
+      chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+      int sw = 1 + next_random(seed, switches_used);
+
+      if(edit % 2 == 0)
+      {
+        /**********************************************************************
+         * Throw sw to one of the switches it could be set to.
+         **********************************************************************/
+
+        int choices = graph.out_degree[sw] > 1 ? graph.out_degree[sw]
+                                               : graph.in_degree[sw];
+
+        if(choices == 0)
+          continue;
+
+        int pick = next_random(seed, choices);
+        int new_default =
+          graph.out_degree[sw] > 1
+            ? track_to(graph.out_track[graph.out_start[sw] + pick])
+            : graph.in_track[graph.in_start[sw] + pick];
+
+        clock = chrono::steady_clock::now();
+
+        if(!set_default(yard, sw, new_default))
+          continue;
+      }
+      else
+      {
+        /**********************************************************************
+         * Close a track off the next switch from sw down with more than one.
+         **********************************************************************/
+
+        while( (sw < switches_used) && (graph.out_degree[sw] < 2) )
+          sw++;
+
+        if(graph.out_degree[sw] < 2)
+          continue;
+
+        /**********************************************************************
+         * sw can't lose the track it's set to, so if that's the one picked,
+         * take the next one.
+         **********************************************************************/
+
+        int pick = next_random(seed, graph.out_degree[sw]);
+
+        if(track_is_default(graph.out_track[graph.out_start[sw] + pick]))
+          pick = (pick + 1) % graph.out_degree[sw];
+
+        int to = track_to(graph.out_track[graph.out_start[sw] + pick]);
+
+        clock = chrono::steady_clock::now();
+
+        if(!close_track(yard, sw, to))
+          continue;
+      }
+
+      edits++;
+
+      resolve_yard(yard);
+
+      edit_us += lap_ms(clock) * 1000;
+      redone += graph.stats.arrivals;
+
+      int full_switches = LARGE_NUMBER;
+      vector<int> full_answer;
+
+      solve_by_dp(graph, get_starting(graph), full_switches, full_answer);
+
+      full_us += lap_ms(clock) * 1000;
+
+      if( (full_switches != yard.system.lowest_switches) ||
+          (full_answer != yard.system.best_answer) )
+        wrong++;
+    }
+
+    cout << setw(10) << switches_used << setw(8) << edits
+         << fixed << setprecision(2)
+         << setw(12) << edit_us / max(edits, 1)
+         << setw(12) << full_us / max(edits, 1)
+         << setw(10) << full_us / max(edit_us, 0.001)
+         << setw(10) << (double)redone / max(edits, 1)
+         << setw(8) << wrong << endl;
+  }
+}
+
+/******************************************************************************
+* run_route_benchmark
+* For -route-bench: for every size from EDIT_BENCH_SMALLEST up to
+* BENCH_LARGEST switches, makes a yard shaped like shape, solves it once
+* with solve_all_starts, and then times find_best_routes asking for 1, 10,
+* ... ROUTE_BENCH_MOST routes. It prints how many it found (a small yard
+* might not have that many), how many flips the last one throws, and how
+* many switches got a sidetrack heap (arrivals).
+******************************************************************************/
+
+void run_route_benchmark(yard_shape shape)
+{
+  cout << setw(10) << "switches" << setw(8) << "asked" << setw(8)
+       << "found" << setw(8) << "best" << setw(8) << "worst" << setw(10)
+       << "heaps" << setw(12) << "routes ms" << setw(10) << "solve ms"
+       << endl;
+
+  for(int switches_used = EDIT_BENCH_SMALLEST;
+      switches_used <= BENCH_LARGEST; switches_used *= 10)
+  {
+    track_graph graph;
+    route_list routes;
+    vector<int> order;
+    vector<int> in_degree;
+    vector<int> exit_cost;
+
+    shape.switches_used = switches_used;
+    make_random_yard(graph, shape);
+
+    chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+
+    solve_all_starts(graph, order, in_degree, exit_cost);
+
+    double solve_ms = lap_ms(clock);
+    int starting_switch = get_starting(graph);
+
+    for(int asked = 1; asked <= ROUTE_BENCH_MOST; asked *= 10)
+    {
+      clear_stats(graph.stats);
+      clock = chrono::steady_clock::now();
+
+      find_best_routes(graph, starting_switch, exit_cost, asked, false,
+                       routes);
+
+      double routes_ms = lap_ms(clock);
+
+      cout << setw(10) << switches_used << setw(8) << asked
+           << setw(8) << routes.flips.size()
+           << setw(8) << routes.flips.front()
+           << setw(8) << routes.flips.back()
+           << setw(10) << graph.stats.arrivals << fixed << setprecision(2)
+           << setw(12) << routes_ms << setw(10) << solve_ms << endl;
+    }
+  }
+}
+
+/******************************************************************************
+* run_score_benchmark
+* For -score-bench: for every size from EDIT_BENCH_SMALLEST up to
+* BENCH_LARGEST switches, makes a yard shaped like shape, solves it once
+* with solve_all_starts, and makes SCORE_BENCH_ROUTES routes through it
+* from random switches. Half of them are the best route from there
+* (walk_best_path), the other half just take random tracks. Then it times
+* score_paths on all of them at once (the second time, so scores already
+* has its memory, like it would scoring batch after batch).
+*
+* "wrong" is how many routes score_paths said weren't routes, throw fewer
+* switches than the best one from the same place, or are the best one and
+* throw more.
+******************************************************************************/
+
+void run_score_benchmark(yard_shape shape)
+{
+  cout << setw(10) << "switches" << setw(8) << "routes" << setw(10)
+       << "steps" << setw(12) << "score ms" << setw(10) << "ns/step"
+       << setw(12) << "routes/ms" << setw(8) << "wrong" << endl;
+
+  for(int switches_used = EDIT_BENCH_SMALLEST;
+      switches_used <= BENCH_LARGEST; switches_used *= 10)
+  {
+    track_graph graph;
+    route_scores scores;
+    vector<int> order;
+    vector<int> in_degree;
+    vector<int> exit_cost;
+    vector<int> path;
+    vector<int> route_start;
+    vector<int> best;
+    unsigned int seed = shape.seed;
+    int best_flips;
+
+    shape.switches_used = switches_used;
+    make_random_yard(graph, shape);
+    solve_all_starts(graph, order, in_degree, exit_cost);
+
+    route_start.push_back(0);
+
+    while( ((int)route_start.size() <= SCORE_BENCH_ROUTES) &&
+           ((int)path.size() < SCORE_BENCH_STEPS) )
+    {
+      int sw = 1 + next_random(seed, switches_used);
+
+      if(route_start.size() % 2 == 0)
+      {
+        walk_best_path(graph, sw, exit_cost, best_flips, best);
+        path.insert(path.end(), best.begin(), best.end());
+      }
+      else
+      {
+        path.push_back(sw);
+
+        while(graph.out_degree[sw] > 0)
+        {
+          sw = track_to(graph.out_track[graph.out_start[sw] +
+                        next_random(seed, graph.out_degree[sw])]);
+          path.push_back(sw);
+        }
+      }
+
+      route_start.push_back(path.size());
+    }
+
+    int routes = route_start.size() - 1;
+
+    score_paths(graph, path.data(), route_start.data(), routes, scores);
+
+    chrono::steady_clock::time_point clock = chrono::steady_clock::now();
+
+    score_paths(graph, path.data(), route_start.data(), routes, scores);
+
+    double score_ms = lap_ms(clock);
+    int wrong = 0;
+
+    for(int route = 0; route < routes; route++)
+    {
+      int least = exit_cost[path[route_start[route]]];
+
+      if( (scores.flips[route] == NOT_A_ROUTE) ||
+          (scores.flips[route] < least) ||
+          ((route % 2 == 1) && (scores.flips[route] != least)) )
+        wrong++;
+    }
+
+    cout << setw(10) << switches_used << setw(8) << routes
+         << setw(10) << path.size() << fixed << setprecision(2)
+         << setw(12) << score_ms
+         << setw(10) << score_ms * 1000000 / max((int)path.size(), 1)
+         << setw(12) << routes / max(score_ms, 0.001)
+         << setw(8) << wrong << endl;
+  }
+}
+
+/******************************************************************************
+* run_server
+* For -serve: reads every track system in input_name and solves it for
+* every switch at once (solve_all_starts), so any question about it is
+* just walk_best_path. Then it answers questions on the Unix socket
+* socket_name until stop_serving says to stop (see main for what they
+* look like).
+*
+* It's one thread, waiting on every client at once with poll(). A
+* question takes about as long as printing its answer, so there's nothing
+* for more threads to do but fight over the systems. Whatever a client
+* sends is answered as soon as it comes in, a whole read at a time, and
+* all the answers go back in one write. So a client that sends a hundred
+* questions without waiting gets a hundred answers back in about the time
+* one takes.
+*
+* A broken system (see check_yard) gets reported when it's read, and
+* every question about it gets the problem back. If the file has a
+* mistake in it, the systems before the mistake are still served.
+*
+* Returns what main should: 1 if it couldn't read the file or listen on
+* the socket, 0 once it's told to stop.
+******************************************************************************/
+
+int run_server(const char *input_name,
+			   bool single_system,
+			   const char *socket_name)
+{
+  vector<track_system> systems;
+  track_reader reader;
+  solve_options options;
+  int total_systems;
+
+  options.use_dfs = false;
+  options.memo = false;
+  options.search_threads = 1;
+  options.all_starts = true;
+  options.every_switch = false;
+  options.routes = 0;
+  options.ties = false;
+  options.budget = 0;
+  options.small_yards = false;
+
+  if(!open_reader(reader, input_name))
+    return 1;
+
+  if(!read_system_count(reader, single_system, total_systems))
+  {
+    close_reader(reader);
+    return 1;
+  }
+
+  for(int t_count = 1; t_count <= total_systems; t_count++)
+  {
+    systems.resize(t_count);
+    systems[t_count - 1].t_count = t_count;
+
+    if(!read_track_system(reader, systems[t_count - 1].graph))
+    {
+      systems.pop_back();
+      break;
+    }
+
+    solve_track_system(systems[t_count - 1], options);
+    report_system(systems[t_count - 1], input_name);
+  }
+
+  close_reader(reader);
+
+  /**************************************************************************
+   * Now open the socket. If there's one left over from last time, it's in
+   * the way, so it goes. Anything else with that name is left alone: it's
+   * probably a file somebody typed by mistake (cymbal -serve cymbal.in).
+   **************************************************************************/
+
+  sockaddr_un address;
+  struct stat info;
+
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+
+  if(strlen(socket_name) >= sizeof(address.sun_path))
+  {
+    cerr << socket_name << ": that's too long for a socket's name" << endl;
+    return 1;
+  }
+
+  if(lstat(socket_name, &info) == 0)
+  {
+    if(!S_ISSOCK(info.st_mode))
+    {
+      cerr << socket_name << ": that's already there, and it isn't a socket"
+           << endl;
+      return 1;
+    }
+
+    unlink(socket_name);
+  }
+
+  strcpy(address.sun_path, socket_name);
+
+  int listener = socket(AF_UNIX, SOCK_STREAM, 0);
+
+  if( (listener < 0) ||
+      (bind(listener, (sockaddr *)&address, sizeof(address)) < 0) ||
+      (listen(listener, SOMAXCONN) < 0) )
+  {
+    cerr << socket_name << ": can't listen on it (" << strerror(errno)
+         << ")" << endl;
+
+    if(listener >= 0)
+      close(listener);
+
+    return 1;
+  }
+
+  fcntl(listener, F_SETFL, O_NONBLOCK);
+
+  signal(SIGINT, stop_serving);
+  signal(SIGTERM, stop_serving);
+  signal(SIGPIPE, SIG_IGN);
+
+  cerr << socket_name << ": serving " << systems.size() << " track systems"
+       << endl;
+
+  /**************************************************************************
+   * And answer questions until we're told to stop. A client only gets
+   * asked for more questions while it doesn't have SERVE_BACKLOG bytes of
+   * answers waiting, and only gets asked to take answers when it has some
+   * waiting.
+   **************************************************************************/
+
+  vector<serve_client> clients;
+  vector<pollfd> waiting;
+
+  while(serving)
+  {
+    waiting.resize(clients.size() + 1);
+
+    waiting[0].fd = listener;
+    waiting[0].events = POLLIN;
+
+    for(int index = 0; index < (int)clients.size(); index++)
+    {
+      serve_client &client = clients[index];
+      size_t unread = client.out.size() - client.out_done;
+
+      waiting[index + 1].fd = client.socket;
+      waiting[index + 1].events =
+        ((unread < (size_t)SERVE_BACKLOG) && !client.finished ? POLLIN : 0) |
+        ((unread > 0) ? POLLOUT : 0);
+    }
+
+    if(poll(waiting.data(), waiting.size(), -1) < 0)
+    {
+      if(errno == EINTR)
+        continue;
+
+      cerr << socket_name << ": " << strerror(errno) << endl;
+      break;
+    }
+
+    for(int index = 0; index < (int)clients.size(); index++)
+    {
+      if(waiting[index + 1].revents & (POLLIN | POLLHUP | POLLERR))
+        read_client(clients[index], systems);
+
+      if(clients[index].out_done < clients[index].out.size())
+        write_client(clients[index]);
+    }
+
+    /************************************************************************
+     * Close up the ones that are done, and let in the new ones.
+     ************************************************************************/
+
+    int kept = 0;
+
+    for(int index = 0; index < (int)clients.size(); index++)
+    {
+      if( clients[index].finished &&
+          (clients[index].out_done == clients[index].out.size()) )
+        close(clients[index].socket);
+      else
+        swap(clients[kept++], clients[index]);
+    }
+
+    clients.resize(kept);
+
+    if(waiting[0].revents & POLLIN)
+    {
+      int connection;
+
+      while((connection = accept(listener, NULL, NULL)) >= 0)
+      {
+        fcntl(connection, F_SETFL, O_NONBLOCK);
+
+        clients.resize(clients.size() + 1);
+        clients.back().socket = connection;
+        clients.back().in.clear();
+        clients.back().out.clear();
+        clients.back().out_done = 0;
+        clients.back().finished = false;
+      }
+    }
+  }
+
+  for(int index = 0; index < (int)clients.size(); index++)
+    close(clients[index].socket);
+
+  close(listener);
+  unlink(socket_name);
+
+  cerr << socket_name << ": stopped" << endl;
+
+  return 0;
+}
+
+/******************************************************************************
+* stop_serving
+* What SIGINT and SIGTERM do during -serve: tell run_server to stop, once
+* it's done with what it's doing.
+******************************************************************************/
+
+void stop_serving(int)
+{
+  serving = 0;
+}
+
+/******************************************************************************
+* read_client
+* Reads whatever client has sent, and puts the answer to every whole line
+* in it on the end of client.out (see answer_query). Anything after the
+* last newline waits in client.in for the rest of it.
+*
+* If the client hung up, or its connection broke, it's finished.
+******************************************************************************/
+
+void read_client(serve_client &client, vector<track_system> &systems)
+{
+  char block[READ_BLOCK];
+  ssize_t bytes = read(client.socket, block, sizeof(block));
+
+  if(bytes <= 0)
+  {
+    if( (bytes == 0) || ((errno != EAGAIN) && (errno != EINTR)) )
+    {
+      client.finished = true;
+
+      if(bytes < 0)
+        client.out_done = client.out.size();
+    }
+
+    return;
+  }
+
+  client.in.append(block, bytes);
+
+  size_t line_start = 0;
+  size_t line_end;
+
+  while((line_end = client.in.find('\n', line_start)) != string::npos)
+  {
+    answer_query(client.out, systems,
+                 client.in.substr(line_start, line_end - line_start));
+
+    line_start = line_end + 1;
+  }
+
+  client.in.erase(0, line_start);
+
+  if(client.in.size() > (size_t)SERVE_LONGEST_QUERY)
+  {
+    client.out += "error: that question is too long\n\n";
+    client.in.clear();
+  }
+}
+
+/******************************************************************************
+* write_client
+* Sends client as much of its answers as it'll take right now. Once it has
+* all of them, out is emptied (but keeps its memory). If the connection
+* broke, there's no one to send the rest to, so it's finished.
+******************************************************************************/
 
-  int total_systems;
-  int total_switches;
+void write_client(serve_client &client)
+{
+  ssize_t bytes = write(client.socket, client.out.data() + client.out_done,
+                        client.out.size() - client.out_done);
 
-  int lowest_switches;
-  int cur_answer[MAX_CASE];
-  int best_answer[MAX_CASE];
+  if(bytes < 0)
+  {
+    if( (errno != EAGAIN) && (errno != EINTR) )
+    {
+      client.finished = true;
+      client.out_done = client.out.size();
+    }
 
-  int starting_switch;
+    return;
+  }
 
-  /**************************************************************************
-   * Alright, now that we have all of our variables, let's start on solving
-   * the problem!!!!
-   *
-   * First thing to do? Read in the input.
-   * It makes sense to read in the input for one subproblem at a time, solving
-   * each subproblem and printing it out as we go.  If anything, this will at
-   * least make the output to the judges screen update and might entertain
-   * them long enough to prevent "Time-Limit Exceeded"
-   *
-   * As specificed, the first line indicates the total number of systems. So
-   * read that in, then iterate through all of the track systems.
-   **************************************************************************/
+  client.out_done += bytes;
 
-  infile >> total_systems;
-	
-  for(int t_count = 1; t_count <= total_systems; t_count++)
+  if(client.out_done == client.out.size())
   {
-    /**********************************************************************
-     * Before we can start solving anything, we need to initialize the 
-     * answers! This is definately a good idea!
-     *
-     * First: set our connectivity matrix to NOT_CONNECTED
-     * (we'll connect it by reading input)
-     *
-     * Second: set the answers to something!
-     * I'm going to set the path to 0 0....
-     * (remember, switch 0 is not allowed because we are 1-based)
-     *
-     * As for the best_number, just set it to some insanely large number.
-     * Doing this will allow the worst answer to overwrite the initialized
-     * values (assuming our large number is larger than the worst answer).
-     **********************************************************************/
+    client.out.clear();
+    client.out_done = 0;
+  }
+}
 
-    for(int from = 0; from < MAX_CASE; from++)
-      for(int to = 0; to < MAX_CASE; to++)
-        connectivity[from][to] = NOT_CONNECTED;
+/******************************************************************************
+* answer_query
+* Puts the answer to one question ("N S", see main) on the end of out.
+* A blank line isn't a question, so it doesn't get an answer.
+******************************************************************************/
 
-    lowest_switches = LARGE_NUMBER;
+void answer_query(string &out,
+				  vector<track_system> &systems,
+				  const string &line)
+{
+  const char *text = line.c_str();
+  char *end;
 
-    for(int answer_num = 0; answer_num < MAX_CASE; answer_num++)
-    {
-      cur_answer[answer_num] = 0;
-      best_answer[answer_num] = 0;
-    }
+  while(isspace((unsigned char)*text))
+    text++;
 
-    /**********************************************************************
-     * Now, we need to read in the input for one track system.
-     *
-     * The first line is the number of switches.
-     * The next lines are the information for each of those switches
-     **********************************************************************/
+  if(*text == '\0')
+    return;
 
-    infile >> total_switches;
+  long t_count = strtol(text, &end, 10);
+  long starting_switch = 0;
 
-    for(int s_count = 1; s_count <= total_switches; s_count++)
-    {
-			
-      /******************************************************************
-       * Right now we are dealing with information about switch # s_count
-       *
-       * It is one line: How many connections; The default switch setting;
-       * then the direct connections.
-       ******************************************************************/
+  if(end != text)
+  {
+    text = end;
+    starting_switch = strtol(text, &end, 10);
 
-      int how_many_connections;
-      int default_setting;
+    while(isspace((unsigned char)*end))
+      end++;
+  }
 
-      infile >> default_setting >> how_many_connections;
+  if( (end == line.c_str()) || (*end != '\0') )
+  {
+    out += "error: can't read '" + line + "'\n\n";
+    return;
+  }
 
-      /******************************************************************
-       * Read in how the tracks directly connect this switch to others.
-       ******************************************************************/
+  if( (t_count < 1) || (t_count > (long)systems.size()) )
+  {
+    out += "error: there's no Track System ";
+    append_number(out, (int)max(min(t_count, (long)LARGEST_INPUT), 0L));
+    out += "\n\n";
+    return;
+  }
 
-      for(int c_count = 1; c_count <= how_many_connections; c_count++)
-      {
-        int temp;
-        infile >> temp;
+  track_system &system = systems[t_count - 1];
 
-        connectivity[s_count][temp] = SWITCH_CONNECTED;
-      }
+  if(!system.problem.empty())
+  {
+    out += "error: Track System ";
+    append_number(out, system.t_count);
+    out += ": " + system.problem + "\n\n";
+    return;
+  }
 
-      /******************************************************************
-       * Set the default!
-       * I do this after reading input to avoid overwriting the setting.
-       * 
-       * If the switch is going "forward", then we should be setting this
-       * to FORWARD_DEFAULT right now by addition.
-       * If it is looking "backward", then it simply has the value of
-       * DEFAULT_CONNECTED.
-       ******************************************************************/
+  if(starting_switch == 0)
+    starting_switch = system.starting_switch;
 
-      connectivity[s_count][default_setting] += DEFAULT_CONNECTED;
-    }
+  if( (starting_switch < 1) ||
+      (starting_switch > system.graph.switches_used) )
+  {
+    out += "error: Track System ";
+    append_number(out, system.t_count);
+    out += " has no switch like that\n\n";
+    return;
+  }
 
-    /**********************************************************************
-     * Yay, we finished initializing and reading the file for this case!
-     * Now what can we do to help Skippy????
-     *
-     * I'll tell you, solve the best answer!!!
-     * Now what you don't know (or maybe you do?), even if there are more
-     * than one answer, we should just find an answer it and print that!
-     * Think about it, he wants to get out as fast a possible.  He doesn't
-     * care which "best" path he takes, he wants to know something fast!
-     *
-     * I'm going to use recursion to solve this, read the comments above
-     * the function to understand how it works.... All you need to know by
-     * looking at this line is that we are going from starting_switch to
-     * the exit and storing the best answer that we get in best_answer.
-     *
-     * To do this, we need to send in:
-     *		How everything is connected
-     *		Where to start
-     *		The lowest answer so far (remember: we set it to a big number)
-     *		The best actual answer (so we can write to it)
-     **********************************************************************/
+  walk_best_path(system.graph, starting_switch, system.exit_cost,
+                 system.lowest_switches, system.best_answer);
+  print_track_system(out, system);
+}
 
-    starting_switch = get_starting(connectivity, total_switches);
+/******************************************************************************
+* run_load_test
+* For -load-test: connects to the -serve on socket_name, and asks it
+* queries questions, about track systems 1 to yards in turn, from where
+* Skippy starts. It keeps pipeline of them waiting at once: whenever
+* fewer are, it sends enough to catch up, all in one write, then reads
+* whatever answers have come back.
+*
+* Each question's time is from just before it was sent to when all of its
+* answer was read. It prints how many questions got answered a second,
+* and the average, median, 99th percentile and longest times.
+******************************************************************************/
 
-    solve_for_one_switch(connectivity, total_switches, NOTHING_DONE, 
-                         starting_switch, NOTHING_DONE, lowest_switches,
-                         cur_answer, NOTHING_DONE, best_answer);
+int run_load_test(const char *socket_name,
+				  int queries,
+				  int pipeline,
+				  int yards)
+{
+  sockaddr_un address;
+  int connection = socket(AF_UNIX, SOCK_STREAM, 0);
 
-    /**********************************************************************
-     * Alright, now we can help Skippy get out! He would be so happy if we
-     * told him the best answer now.... So let's do that!
-     *
-     * How, you ask? Well it's kind of complicated. We have the path stored
-     * in best answer, but Skippy wants to know which switches to throw!
-     * Drats! Where's the fun in that!
-     *
-     * Ok, we want to go through all of the switches. If you remember, I 
-     * kept writing 0 0 0 0 0 0 after the path. That's helpful, because
-     * now I can just keep displaying stuff until I see a 0 (again, no 
-     * switch is number 0 because we are 1-based).
-     *
-     * I start off by setting the current switch equal to the second switch
-     * and the last switch equal to the starting_switch.
-     *
-     * Now for every possible set of 2 switches located directly next to
-     * each other (ie, current and last), we can look up if we should print
-     * either one of the or both of them. How?
-     *
-     * If the last switch has more than one output, It is looking at the
-     * current switch, so we need to print it because we could not determine
-     * what to print last time around.  So we can check if it connects to
-     * this switch by default. If it does, then we dont need to print (x),
-     * we will need to print (x) to indicate a switch has been thrown.
-     *
-     * If the current switch connects many tracks to one, we need to print
-     * it right away!!! We need to look at the switch setting of the last
-     * switch. If it is not the default, print it with (x). Otherwise, we
-     * just print the switch like normal.
-     *
-     * Note that once we print the value, it will not be printed as a 
-     * again even though it goes through the printing conditionals twice!
-     * This is because a switch can look "forward" or "backward", but it
-     * can NOT be both!
-     **********************************************************************/
+  memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  strncpy(address.sun_path, socket_name, sizeof(address.sun_path) - 1);
+
+  if( (connection < 0) ||
+      (connect(connection, (sockaddr *)&address, sizeof(address)) < 0) )
+  {
+    cerr << socket_name << ": can't connect to it (" << strerror(errno)
+         << ")" << endl;
+    return 1;
+  }
+
+  vector<chrono::steady_clock::time_point> sent(queries);
+  vector<double> took_us(queries);
+  string questions;
+  string answers;
+  char block[READ_BLOCK];
+  int asked = 0;
+  int answered = 0;
+  int errors = 0;
 
-    int path_index = 1;
-    int last_switch = starting_switch;
-    int current_switch;
+  chrono::steady_clock::time_point started = chrono::steady_clock::now();
 
-    cout << "Track System " << t_count << ":" << endl;
+  while(answered < queries)
+  {
+    questions.clear();
 
-    while(best_answer[path_index] != 0)
+    while( (asked < queries) && (asked - answered < pipeline) )
     {
-      current_switch = best_answer[path_index];
+      append_number(questions, asked % yards + 1);
+      questions += " 0\n";
+      sent[asked++] = chrono::steady_clock::now();
+    }
 
-      int temp_val;
-			
-      /******************************************************************
-       * Here's the code for a switch that comes from one track and goes
-       * to more than one. (A "forward" switch.)
-       ******************************************************************/
+    for(size_t done = 0; done < questions.size(); )
+    {
+      ssize_t bytes = write(connection, questions.data() + done,
+                            questions.size() - done);
 
-      temp_val = connects_to_x(connectivity, total_switches, last_switch);
-      if(temp_val > 1)
+      if(bytes <= 0)
       {
-        cout << last_switch;
+        cerr << socket_name << ": it stopped listening" << endl;
+        close(connection);
+        return 1;
+      }
 
-        if( (connectivity[last_switch][current_switch] != 
-             DEFAULT_CONNECTED) &&
-            (connectivity[last_switch][current_switch] !=
-             FORWARD_DEFAULT) )
-        {
-          cout << '(' << current_switch << ')';
-        }
+      done += bytes;
+    }
 
-        cout << ' ';
-      }
+    ssize_t bytes = read(connection, block, sizeof(block));
 
-      /******************************************************************
-       * Here's the code for a switch that comes from any number of tracks
-       * and either leaves the system or travels along one track.
-       * (A "backward" switch).
-       ******************************************************************/
+    if(bytes <= 0)
+    {
+      cerr << socket_name << ": it hung up" << endl;
+      close(connection);
+      return 1;
+    }
 
-      temp_val = connects_to_x(connectivity, total_switches, 
-                               current_switch);
-      if(temp_val <= 1)
-      {
-        if(connectivity[current_switch][last_switch] != 
-           DEFAULT_CONNECTED)
-        {
-          cout << '(' << last_switch << ')';
-        }
+    answers.append(block, bytes);
 
-        cout << current_switch;
+    size_t answer_start = 0;
+    size_t length;
 
-        cout << ' ';
-      }
+    while((length = reply_length(answers, answer_start)) > 0)
+    {
+      took_us[answered] = chrono::duration<double, micro>(
+        chrono::steady_clock::now() - sent[answered]).count();
 
-      last_switch = current_switch;
-      path_index++;
-    }
+      if(answers.compare(answer_start, 6, "error:") == 0)
+        errors++;
 
-    cout << endl << endl;
+      answered++;
+      answer_start += length;
+    }
 
-    /**********************************************************************
-     * YAY! We solved one track system!
-     **********************************************************************/
+    answers.erase(0, answer_start);
   }
 
-  /**************************************************************************
-   * Closing files is a good practice...
-   **************************************************************************/
+  double seconds = chrono::duration<double>(chrono::steady_clock::now() -
+                                            started).count();
+  double total_us = 0;
 
-  infile.close();
+  close(connection);
 
-  return 0;
+  for(int query = 0; query < queries; query++)
+    total_us += took_us[query];
+
+  sort(took_us.begin(), took_us.end());
+
+  cout << queries << " questions, " << pipeline << " at a time: " << fixed
+       << setprecision(0) << queries / seconds << " a second, "
+       << setprecision(1) << total_us / queries << " us average, "
+       << took_us[queries / 2] << " us median, "
+       << took_us[(int)(queries * 0.99)] << " us 99th, "
+       << took_us[queries - 1] << " us longest, " << errors << " errors"
+       << endl;
+
+  return (errors == 0) ? 0 : 1;
 }
 
 /******************************************************************************
-* get_starting
-* We figure out the starting point by simply looking at each column
-* to see if anything connects to the switch. When we find an answer, we simply
-* return it, because Skippy cannot be at more than one switch right now.
+* reply_length
+* How long the answer from -serve starting at in[from] is, or 0 if it
+* hasn't all come in yet. A route is three lines ("Track System N:", the
+* route, and a blank one), an error is two. Counting lines works even when
+* the route line is empty. Until the first 6 bytes are in, there's no
+* telling which it is.
 ******************************************************************************/
 
-int get_starting(int connectivity[MAX_CASE][MAX_CASE], int num_switches)
+size_t reply_length(const string &in, size_t from)
 {
-  for(int to = 1; to <= num_switches; to++)
+  if(in.size() < from + 6)
+    return 0;
+
+  int lines = (in.compare(from, 6, "error:") == 0) ? 2 : 3;
+  size_t end = from;
+
+  for(int line = 0; line < lines; line++)
   {
-    int counter = 0;
+    end = in.find('\n', end);
 
-    for(int from = 1; from <= num_switches; from++)
-    {
-      if( (connectivity[from][to] == SWITCH_CONNECTED) ||
-          (connectivity[from][to] == FORWARD_DEFAULT) )
-        counter++;
-    }
+    if(end == string::npos)
+      return 0;
 
-    if(counter == 0)
-      return to;
+    end++;
   }
 
-  /**************************************************************************
-   * We should NEVER get to this line, but C++ likes to complain about missing
-   * return statements, so in the bizarre case that we don't find the start
-   * switch, we are gauranteed that switch 1 exists! So just return it as the
-   * first one.
-   **************************************************************************/
-
-  return 1;
+  return end - from;
 }
 
 /******************************************************************************
-* solve_for_one_switch
-* Wow, how to explain this one??? First off: It has a lot of arguments...
-*
-* connectivity:   The matrix representing how the tracks connect switches.
-*
-* switches_used:  How many switches exist in this system.
-*
-* current_val:    The number of switches we've thrown so far to get here.
-*
-* current_switch: Which switch we are at right now.
-*
-* last_switch:    The last switch that we were at. This is needed for the 
-*				  "backwards" to see if it is the default setting.
-*
-* best_so_far:    Lowest number of switches thrown in all previous solutions.
-*                 Note that we need to overwrite this value as we go!
-*
-* answer:         The current path we are taking.
-*
-* answer_index:   Which index of answer we are currently able to write to.
-*                 (How many switches are in the current answer.)
-*
-* best_answer:    The path of the best answer we've found so far.
-*
-* How does this work??? I really hope I can put this in english...
-*
-* We don't need to know how the entire system connects to solve this problem.
-* All we need to know is how to get from the point A to B if A and B are
-* directly connected. So that's what I'm doing. If you remember, in main, I
-* call this function using STARTING_POINT as the current switch and 
-* NOTHING_DONE as the last switch. So first time around, we try to go from
-* STARTING_POINT to everything that STARTING_POINT can directly connect to.
-* If we throw a switch, we let the system know...
-*
-* By doing this, we can keep track of how many switches we have to throw to
-* get all the way to the exit. Because Skippy constantly moves downhill and
-* there are no dead ends (it would be an exit), We will connect every switch
-* that we are able to get to to everything else and eventually find the exit.
-* We will keept track of the total number of switches thrown so far by simply
-* adding the 0 or 1 to get from every switch on the path.
-*
-* example: 1 connects to 2, 3. It defaults to 2.
-*
-* We first say, "ok, we can get to 2 without flipping a switch, so start from
-* switch 2 and see if we can get out of the track system from switch two."
-*
-* Likewise, we try from switch 3, but we say "we threw one more switch to get
-* to 3, so remember that".
-*
-* The only other kicker, we have to look "backwards" as we travel on a track.
-* We have to make sure that a "many-to-one" switch is defaulted to the track
-* that we came from. If the last track is NOTHING_DONE, that's no biggie. But,
-* that only happens on the first call, so we need to increment the switch count
-* if we look "backwards" and realize that a switch was throw to get here.
-*
-* My last remark, by the time we get through this function, "answer" will have
-* taken the value of a lot of possible paths (possibly longer than the best
-* answer). I'm just saying this to help readers understand how this works.
+* lap_ms
+* Returns how many milliseconds it has been since "since", and moves since
+* up to now, so the next call times the next thing.
 ******************************************************************************/
 
-void solve_for_one_switch(const int connectivity[MAX_CASE][MAX_CASE],
-						  const int &switches_used,
-						  int current_val,
-						  int current_switch,
-						  int last_switch,
-						  int &best_so_far,
-						  int answer[MAX_CASE],
-						  int answer_index,
-						  int best_answer[MAX_CASE])
+double lap_ms(chrono::steady_clock::time_point &since)
 {
-  /**************************************************************************
-   * Easiest thing to do? If we are currently in a track position,
-   * such that we have flipped more (or an equal number of)
-   * switches then the "best" path would use, there is really no reason
-   * to solve the answer from this switch to the exit, as it CAN'T be better
-   * than anything previously computed.
-   *
-   * Essentially, if we flipped a bunch of switches, and the
-   * best answer so far flipped less switches, it doesn't matter
-   * where we go from here. We cannot find a better answer, so just
-   * give up!
-   *
-   * Before we can determine that, we must look at how we got to the current
-   * switch. If it's a switch with a bunch of tracks coming to it and
-   * one path exiting, then we need to make sure that switch is set.
-   * We count how many tracks are leaving the current switch.
-   * If the number is 0, we are at the exit. If the number is 1, a whole
-   * bunch came together and, after this, we are going forward to one 
-   * specific switch.  In either case, we just look "backwards" to see if 
-   * the switch is ok!
-   **************************************************************************/
-
-  int howmany = connects_to_x(connectivity, switches_used, current_switch);
-
-  if((howmany <= 1) && (last_switch != NOTHING_DONE))
-  {
-    if(connectivity[current_switch][last_switch] == NOT_CONNECTED)
-      current_val++;
-  }
+  chrono::steady_clock::time_point now = chrono::steady_clock::now();
+  double ms = chrono::duration<double, milli>(now - since).count();
 
-  /**************************************************************************
-   * Here's the "give up if the current answer is worse" line.
-   * This line will drastically increase timing on big test cases. If your
-   * team got a lot of "Time-Limit Exceeded" responses, This is probably why!
-   * If you don't believe me, remove it and run this program :)
-   *
-   * There are much better ways to speed this program up, but this is the
-   * easiest approach and the judge data will not test for any other kind of
-   * optimizations.
-   **************************************************************************/
+  since = now;
 
-  if(current_val >= best_so_far)
-    return;
+  return ms;
+}
 
-  /**************************************************************************
-   * Ok, if we get here, then we might be looking at a better solution.
-   * So now check to see, did we exit the system?
-   * If we exited then... connectivity[current_switch][1] through
-   * connectivity[current_switch][switches_used] will all == NOT_CONNECTED
-   *
-   * If it is the best solution, we need to copy the current path
-   * into our "best" path. We also need to set the number of switches thrown
-   * in the best path to the current value. Once we do this, we don't need
-   * to try and connect to any more switches. So, we can exit the function.
-   **************************************************************************/
+/******************************************************************************
+* clear_stats
+* Sets every counter in stats back to zero.
+******************************************************************************/
 
-  if(howmany == 0)
-  {
-    answer[answer_index] = current_switch;
+void clear_stats(search_stats &stats)
+{
+  stats.arrivals = NOTHING_DONE;
+  stats.prunes = NOTHING_DONE;
+  stats.improvements = NOTHING_DONE;
+  stats.max_depth = NOTHING_DONE;
+}
 
-    array_copy(best_answer, answer, answer_index);
+/******************************************************************************
+* add_stats
+* Adds the counters in more onto total. The deepest path is the deeper of
+* the two, not their sum.
+******************************************************************************/
 
-    best_so_far = current_val;
+void add_stats(search_stats &total, const search_stats &more)
+{
+  total.arrivals += more.arrivals;
+  total.prunes += more.prunes;
+  total.improvements += more.improvements;
+  total.max_depth = max(total.max_depth, more.max_depth);
+}
 
-    return;
-  }
+/******************************************************************************
+* open_profile
+* Opens the file called name for -profile and writes the CSV header (or the
+* start of the JSON array, if name ends in .json). Says so and returns false
+* if it can't.
+******************************************************************************/
 
-  /**************************************************************************
-   * Well, we didn't find the exit yet :(
-   * So, let's store we're we are now in our answer and continue through the
-   * program. We are going to try every connection possible and see if it is
-   * the overall best answer. This can be seen as a DFS (depth first search)
-   * or best visualized as having a rope and inserting it into a plumbing
-   * system. The rop can go down a whole bunch of paths but only one at a
-   * time. Instead of pulling it all the way out of the pipes, you try to move
-   * the ope into every pipe that the current pipe you are in connects to.
-   *
-   * If you remember, we have 4 possibilities:
-   *
-   * NOT_CONNECTED: In this case, we don't need to try to find an exit
-   * because we can't get there!
-   *
-   * SWITCH_CONNECTED: We can get there, but we must increment the current_val
-   * because we have to throw a switch to use this track
-   *
-   * DEFAULT_CONNECTED: This setting was taken care of already, this is when
-   * a track comes to a switch that yields 1 or 0 tracks. because all of the
-   * tracks we want to recurse on are going "forward", this is not an option!
-   *
-   * FORWARD_DEFAULT: This means we can get to the next switch using a track
-   * without throwing the switch we are at right now. So we just call the
-   * same function changing where we are and the answer path.
-   **************************************************************************/
+bool open_profile(track_profile &profile, const char *name)
+{
+  size_t length = strlen(name);
 
-  answer[answer_index] = current_switch;
-  answer_index++;
+  profile.file = fopen(name, "wb");
+  profile.json = (length >= 5) && (strcmp(name + length - 5, ".json") == 0);
+  profile.first = true;
 
-  for(int to = 1; to <= switches_used; to++)
+  if(profile.file == NULL)
   {
-    if(connectivity[current_switch][to] == SWITCH_CONNECTED)
-    {
-      if(howmany == 1)
-      {
-				
-        solve_for_one_switch(connectivity, switches_used,
-                             current_val,
-                             to, current_switch, best_so_far, 
-                             answer, answer_index, best_answer);
-      }
-      else
-      {
-        solve_for_one_switch(connectivity, switches_used, 
-                             current_val + 1,
-                             to, current_switch, best_so_far, 
-                             answer, answer_index, best_answer);
-      }
-    }
-
-    if(connectivity[current_switch][to] == FORWARD_DEFAULT)
-    {
-      solve_for_one_switch(connectivity, switches_used,
-                           current_val,
-                           to, current_switch, best_so_far, 
-                           answer, answer_index, best_answer);
-    }
+    cerr << name << ": can't write to it" << endl;
+    return false;
   }
-}
 
+  if(profile.json)
+    fputs("[", profile.file);
+  else
+    fputs("system,switches,tracks,flips,arrivals,prunes,improvements,"
+          "max_depth,degree_lookups,parse_ms,solve_ms,print_ms\n",
+          profile.file);
+
+  return true;
+}
 
 /******************************************************************************
-* connects_to_x
-* This function takes the connectivity matrix and which switch we are at.
-* It returns how many exits the switch has as an integer.
+* write_profile
+* Writes one line about a solved (and printed) system to the -profile file.
 ******************************************************************************/
 
-int connects_to_x(const int connectivity[MAX_CASE][MAX_CASE],
-				  const int &switches_used,
-				  const int &switch_num)
+void write_profile(track_profile &profile, const track_system &system)
 {
-  int count = 0;
-  for(int to = 1; to <= switches_used; to++)
-    if( (connectivity[switch_num][to] == SWITCH_CONNECTED) ||
-        (connectivity[switch_num][to] == FORWARD_DEFAULT) )
-      count++;
+  const track_graph &graph = system.graph;
+  const search_stats &stats = graph.stats;
 
-  return count;
+  if(profile.json)
+  {
+    fprintf(profile.file, "%s\n  {\"system\": %d, \"switches\": %d, "
+            "\"tracks\": %d, \"flips\": %d, \"arrivals\": %lld, "
+            "\"prunes\": %lld, \"improvements\": %lld, \"max_depth\": %d, "
+            "\"degree_lookups\": %lld, \"parse_ms\": %.4f, "
+            "\"solve_ms\": %.4f, \"print_ms\": %.4f}",
+            profile.first ? "" : ",", system.t_count, graph.switches_used,
+            (int)graph.out_track.size(), system.lowest_switches,
+            stats.arrivals, stats.prunes, stats.improvements,
+            stats.max_depth, graph.degree_lookups, system.parse_ms,
+            system.solve_ms, system.print_ms);
+  }
+  else
+  {
+    fprintf(profile.file, "%d,%d,%d,%d,%lld,%lld,%lld,%d,%lld,%.4f,%.4f,"
+            "%.4f\n", system.t_count, graph.switches_used,
+            (int)graph.out_track.size(), system.lowest_switches,
+            stats.arrivals, stats.prunes, stats.improvements,
+            stats.max_depth, graph.degree_lookups, system.parse_ms,
+            system.solve_ms, system.print_ms);
+  }
+
+  profile.first = false;
 }
 
 /******************************************************************************
-* array_copy
-* This copies the first n elements of "from" into "to". It then makes the
-* rest of the array equal to 0.
-*
-* This last part should be noted because the final answer could recurse deep 
-* into the matrix and change the answer. We need to make sure that we only 
-* output the number of switches in the answer.
+* close_profile
+* Finishes the JSON array (CSV doesn't need finishing) and closes the file.
 ******************************************************************************/
 
-void array_copy(int to[MAX_CASE], const int from[MAX_CASE], int up_to_n)
+void close_profile(track_profile &profile)
 {
-  int i;
-  for(i = 0; i <= up_to_n; i++)
-    to[i] = from[i];
-
-  for(i; i < MAX_CASE; i++)
-    to[i] = 0;
+  if(profile.json)
+    fputs(profile.first ? "]\n" : "\n]\n", profile.file);
 
+  fclose(profile.file);
+  profile.file = NULL;
 }
 
-
 /******************************************************************************
 * Well, that's it! I hope this has been insightful.
 ******************************************************************************/
@@ -0,0 +1,142 @@
+/******************************************************************************
+* cymbal.h
+* The solver from cymbal.cpp, for programs that want to use it without
+* running cymbal and reading its output.
+*
+* compile cymbal.cpp with -DCYMBAL_NO_MAIN and link it in with your program:
+*
+*		g++ -O2 -pthread -DCYMBAL_NO_MAIN -c cymbal.cpp
+*
+* A track_solver holds one yard at a time. Build it a switch at a time,
+* exactly like one track system in cymbal.in, then ask it for the route:
+*
+*		track_solver *solver = create_solver();
+*		track_route route;
+*		int tracks[] = { 2, 3 };
+*
+*		start_yard(solver, 3);
+*		add_switch(solver, 1, 3, tracks, 2);
+*		add_switch(solver, 2, 3, tracks + 1, 1);
+*		add_switch(solver, 3, 1, NULL, 0);
+*		solve_route(solver, route);
+*
+* Every switch is set to one it has a track to (or, for switch 3, from),
+* like check_yard wants. Skippy starts at 1, which is already set straight
+* to the exit, and the exit is set back to 1, so route.path comes back 1 3
+* with no flips.
+*
+* Once it's solved, solve_route_from and route_cost answer the same thing
+* for a cart starting anywhere else, without solving it again.
+*
+* score_routes goes the other way: it's handed routes (thousands at a time,
+* say, from something that plans where the carts go) and works out what
+* each one throws, without solving anything:
+*
+*		int path[] = { 1, 2, 3,   2, 3 };
+*		int route_start[] = { 0, 3, 5 };
+*		route_scores scores;
+*
+*		score_routes(solver, path, route_start, 2, scores);
+*
+* The solver keeps all of its memory between yards, and route keeps its
+* own, so once they've seen a yard as big as the ones coming, solving more
+* of them doesn't ask for any memory at all.
+******************************************************************************/
+
+#ifndef CYMBAL_H
+#define CYMBAL_H
+
+#include <string>
+#include <vector>
+
+/******************************************************************************
+* track_solver
+* Everything the solver needs for one yard. What's inside is cymbal.cpp's
+* business, so it only comes as a pointer from create_solver.
+******************************************************************************/
+
+struct track_solver;
+
+/******************************************************************************
+* track_route
+* The answer for a yard.
+*
+* starting_switch: Where Skippy is.
+*
+* flips:           How many switches he has to throw.
+*
+* path:            Every switch he rolls over, from starting_switch to the
+*				   exit.
+*
+* thrown, thrown_to: The switches on path he has to throw, in order, and
+*				   which switch each one has to be set to.
+******************************************************************************/
+
+struct track_route
+{
+  int starting_switch;
+  int flips;
+
+  std::vector<int> path;
+  std::vector<int> thrown;
+  std::vector<int> thrown_to;
+};
+
+/******************************************************************************
+* route_scores
+* What score_routes says about routes it was handed, one spot per route.
+*
+* flips:           How many switches each route throws, or -1 if it isn't
+*				   a route in this yard.
+*
+* thrown_start:    Route R's thrown switches are thrown[thrown_start[R]] up
+*				   to (not including) thrown[thrown_start[R + 1]].
+*
+* thrown, thrown_to: The switches thrown, in order, and which switch each
+*				   one has to be set to, like track_route.
+******************************************************************************/
+
+struct route_scores
+{
+  std::vector<int> flips;
+  std::vector<int> thrown_start;
+  std::vector<int> thrown;
+  std::vector<int> thrown_to;
+};
+
+/******************************************************************************
+* function prototypes (detailed information can be found in cymbal.cpp)
+******************************************************************************/
+
+track_solver *create_solver();
+
+void destroy_solver(track_solver *solver);
+
+void start_yard(track_solver *solver, int switches_used);
+
+bool add_switch(track_solver *solver,
+				int switch_num,
+				int default_setting,
+				const int *tracks,
+				int how_many);
+
+bool solve_route(track_solver *solver, track_route &route);
+
+bool solve_route_from(track_solver *solver, int starting_switch,
+					  track_route &route);
+
+int route_cost(track_solver *solver, int starting_switch);
+
+bool change_default(track_solver *solver, int switch_num, int new_default);
+
+bool remove_track(track_solver *solver, int from, int to);
+
+void print_route(track_solver *solver, int t_count, std::string &out);
+
+bool score_routes(track_solver *solver,
+				  const int *path,
+				  const int *route_start,
+				  int routes,
+				  route_scores &scores);
+
+#endif